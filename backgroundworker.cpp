@@ -0,0 +1,15 @@
+#include "backgroundworker.h"
+
+BackgroundWorker::BackgroundWorker()
+{
+  /* A single thread is enough, since only the latest job matters and the others stop as soon as they notice. */
+
+  m_threadPool.setMaxThreadCount(1);
+}
+
+BackgroundWorker::~BackgroundWorker()
+{
+  cancel();
+
+  m_threadPool.waitForDone();
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <QMetaObject>
+#include <QObject>
+#include <QThreadPool>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <utility>
+
+#include <cstdint>
+
+/// @brief Runs jobs on a background thread, where each job supersedes the ones before it.
+///
+/// @detail This is for work that the user interface has to redo after each edit, where only the result of the latest
+///         edit is of interest. Starting a job cancels the jobs started before it: those that haven't started are
+///         skipped, the one that is running can stop early by polling the function it is given, and results that
+///         were already on their way are dropped.
+///
+///         The result of a job is handed back on the thread of the receiving object, through its event loop. The
+///         worker is meant to be a member of the receiver, so that it waits for its thread, in its destructor, before
+///         the receiver goes away.
+class BackgroundWorker final
+{
+public:
+  /// @brief Indicates whether a newer job has been started, in which case the result is no longer needed.
+  using IsCancelled = std::function<bool()>;
+
+  BackgroundWorker();
+
+  BackgroundWorker(const BackgroundWorker&) = delete;
+
+  auto operator=(const BackgroundWorker&) -> BackgroundWorker& = delete;
+
+  /// @brief Cancels the current job and waits for it to stop.
+  ~BackgroundWorker();
+
+  /// @brief Starts a job, cancelling the previous ones.
+  ///
+  /// @param receiver The object on whose thread @p done is called.
+  /// @param job The work to do on the background thread. It must not touch anything that the receiver's thread may
+  ///            change in the meantime.
+  /// @param done Receives the result of the job, unless a newer job was started in the meantime.
+  template<typename Result>
+  void run(QObject* receiver, std::function<Result(const IsCancelled&)> job, std::function<void(Result&&)> done);
+
+  /// @brief Cancels the current job, without starting a new one.
+  void cancel() { m_generation++; }
+
+private:
+  QThreadPool m_threadPool;
+
+  /// @brief Counts the jobs started so far. A job has been superseded once this no longer matches its own number.
+  std::atomic<std::uint64_t> m_generation{ 0 };
+};
+
+template<typename Result>
+void
+BackgroundWorker::run(QObject* receiver,
+                      std::function<Result(const IsCancelled&)> job,
+                      std::function<void(Result&&)> done)
+{
+  const auto generation = ++m_generation;
+
+  const IsCancelled isCancelled = [this, generation]() { return m_generation.load() != generation; };
+
+  m_threadPool.start([receiver, job, done, isCancelled]() {
+    if (isCancelled())
+      return;
+
+    auto result = std::make_shared<Result>(job(isCancelled));
+
+    if (isCancelled())
+      return;
+
+    /* The check is repeated on the receiving thread, since a newer job may have started while this was queued. */
+
+    QMetaObject::invokeMethod(
+      receiver,
+      [done, isCancelled, result]() {
+        if (!isCancelled())
+          done(std::move(*result));
+      },
+      Qt::QueuedConnection);
+  });
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "model.h"
+#include "node.h"
+
+/// @brief Builds a dense input -> hidden -> output network with the given number of nodes in each of its layers.
+///
+/// @detail The connections are made directly on the nodes, which skips the checks done by @ref Model::connect, since
+///         the benchmarks using this are only interested in what happens to the model afterwards.
+inline void
+buildDenseModel(Model& model, int width)
+{
+  for (int i = 0; i < width; i++)
+    model.createInputNode();
+
+  for (int i = 0; i < width; i++)
+    model.createHiddenNode();
+
+  for (int i = 0; i < width; i++)
+    model.createOutputNode();
+
+  for (const auto& hiddenNode : model.getHiddenNodes()) {
+    for (const auto& inputNode : model.getInputNodes())
+      hiddenNode->addConnection(inputNode);
+  }
+
+  for (const auto& outputNode : model.getOutputNodes()) {
+    for (const auto& hiddenNode : model.getHiddenNodes())
+      outputNode->addConnection(hiddenNode);
+  }
+}
@@ -0,0 +1,55 @@
+/* Measures how long it takes to build a dense model through the editing interface of the model.
+ *
+ * Each model connects every one of its input nodes to every one of its output nodes with Model::connect, the way the
+ * model view does, which checks the kinds of both nodes and whether they are already connected. If both checks take
+ * constant time, the time per connection stays flat as the width grows. */
+
+#include "model.h"
+#include "node.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+int
+main(int argc, char** argv)
+{
+  const int maxWidth = (argc > 1) ? std::atoi(argv[1]) : 10000;
+
+  std::vector<int> widths;
+
+  for (int width = maxWidth; width >= 16; width /= 2)
+    widths.insert(widths.begin(), width);
+
+  std::printf("%8s %12s %12s %10s\n", "width", "connections", "build ms", "ns/conn");
+
+  for (const auto width : widths) {
+
+    Model model;
+
+    const auto start = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < width; i++)
+      model.createInputNode();
+
+    for (int i = 0; i < width; i++)
+      model.createOutputNode();
+
+    for (const auto& outputNode : model.getOutputNodes()) {
+      for (const auto& inputNode : model.getInputNodes())
+        model.connect(outputNode.get(), inputNode);
+    }
+
+    const auto stop = std::chrono::steady_clock::now();
+
+    const double seconds = std::chrono::duration<double>(stop - start).count();
+
+    const auto connectionCount = model.getConnectionCount();
+
+    std::printf(
+      "%8d %12zu %12.3f %10.2f\n", width, connectionCount, seconds * 1e3, (seconds * 1e9) / connectionCount);
+  }
+
+  return 0;
+}
@@ -0,0 +1,56 @@
+/* Measures how the size of the compiled program and the time taken to compile it scale with the size of the model.
+ *
+ * Each model is a dense input -> hidden -> output network of the given width. If every node is lowered exactly once,
+ * the number of instructions per connection stays constant as the width grows. */
+
+#include "benchmodels.h"
+#include "compiler.h"
+#include "graph.h"
+#include "model.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+int
+main(int argc, char** argv)
+{
+  const int maxWidth = (argc > 1) ? std::atoi(argv[1]) : 512;
+
+  std::printf("%8s %12s %12s %10s %12s %10s\n", "width", "connections", "exprs", "exprs/conn", "compile ms", "ns/conn");
+
+  for (int width = 16; width <= maxWidth; width *= 2) {
+
+    Model model;
+
+    buildDenseModel(model, width);
+
+    const auto connectionCount = model.getConnectionCount();
+
+    const auto start = std::chrono::steady_clock::now();
+
+    const Graph graph(model);
+
+    /* Layers are lowered into one instruction each, which would hide how the node by node lowering scales. */
+
+    Compiler compiler(graph);
+
+    compiler.setMinLayerSize(0);
+
+    const Program program = compiler.compile();
+
+    const auto stop = std::chrono::steady_clock::now();
+
+    const double seconds = std::chrono::duration<double>(stop - start).count();
+
+    std::printf("%8d %12zu %12zu %10.2f %12.3f %10.2f\n",
+                width,
+                connectionCount,
+                program.size(),
+                double(program.size()) / connectionCount,
+                seconds * 1e3,
+                (seconds * 1e9) / connectionCount);
+  }
+
+  return 0;
+}
@@ -0,0 +1,156 @@
+/* Measures compile time and memory use on deep models, like the ones imported from other tools.
+ *
+ * Each model is a chain of hidden layers of a fixed width, with every node connected to all nodes of the layer
+ * before it. The memory figures count the bytes requested from the heap while compiling, which includes the snapshot
+ * of the model's topology, the scratch space of the compiler and the resulting program. */
+
+#include "compiler.h"
+#include "graph.h"
+#include "model.h"
+#include "node.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+std::atomic<std::size_t> g_allocationCount{ 0 };
+
+std::atomic<std::size_t> g_currentBytes{ 0 };
+
+std::atomic<std::size_t> g_peakBytes{ 0 };
+
+/* The size of each allocation is kept in front of the block, so that it can be subtracted again when it's freed. */
+
+constexpr std::size_t g_headerSize = alignof(std::max_align_t);
+
+void
+resetPeak()
+{
+  g_peakBytes = g_currentBytes.load();
+  g_allocationCount = 0;
+}
+
+void
+buildDeepModel(Model& model, int layerCount, int width)
+{
+  for (int i = 0; i < width; i++)
+    model.createInputNode();
+
+  /* Hidden nodes can only be connected to input nodes through the model, so the layers are wired up directly on the
+   * nodes instead. */
+
+  for (int layer = 0; layer < layerCount; layer++) {
+    for (int i = 0; i < width; i++)
+      model.createHiddenNode();
+  }
+
+  for (int i = 0; i < width; i++)
+    model.createOutputNode();
+
+  const auto& inputs = model.getInputNodes();
+  const auto& hidden = model.getHiddenNodes();
+  const auto& outputs = model.getOutputNodes();
+
+  for (int layer = 0; layer < layerCount; layer++) {
+    for (int i = 0; i < width; i++) {
+      for (int j = 0; j < width; j++) {
+        auto& node = hidden[(layer * width) + i];
+        node->addConnection((layer == 0) ? inputs[j] : hidden[((layer - 1) * width) + j]);
+      }
+    }
+  }
+
+  for (int i = 0; i < width; i++) {
+    for (int j = 0; j < width; j++)
+      outputs[i]->addConnection(hidden[((layerCount - 1) * width) + j]);
+  }
+}
+
+} // namespace
+
+void*
+operator new(std::size_t size)
+{
+  auto* block = static_cast<unsigned char*>(std::malloc(size + g_headerSize));
+  if (!block)
+    throw std::bad_alloc();
+
+  *reinterpret_cast<std::size_t*>(block) = size;
+
+  g_allocationCount++;
+
+  const auto current = (g_currentBytes += size);
+
+  auto peak = g_peakBytes.load();
+
+  while ((current > peak) && !g_peakBytes.compare_exchange_weak(peak, current)) {
+  }
+
+  return block + g_headerSize;
+}
+
+void
+operator delete(void* ptr) noexcept
+{
+  if (!ptr)
+    return;
+
+  auto* block = static_cast<unsigned char*>(ptr) - g_headerSize;
+
+  g_currentBytes -= *reinterpret_cast<std::size_t*>(block);
+
+  std::free(block);
+}
+
+void
+operator delete(void* ptr, std::size_t) noexcept
+{
+  operator delete(ptr);
+}
+
+int
+main(int argc, char** argv)
+{
+  const int maxLayerCount = (argc > 1) ? std::atoi(argv[1]) : 16384;
+
+  const int width = (argc > 2) ? std::atoi(argv[2]) : 4;
+
+  std::printf("%8s %8s %12s %12s %12s %12s %10s\n", "layers", "nodes", "connections", "exprs", "compile ms", "peak KiB",
+              "allocs");
+
+  for (int layerCount = 1024; layerCount <= maxLayerCount; layerCount *= 2) {
+
+    Model model;
+
+    buildDeepModel(model, layerCount, width);
+
+    resetPeak();
+
+    const auto baseBytes = g_currentBytes.load();
+
+    const auto start = std::chrono::steady_clock::now();
+
+    const Graph graph(model);
+
+    const Program program = Compiler(graph).compile();
+
+    const auto stop = std::chrono::steady_clock::now();
+
+    const double seconds = std::chrono::duration<double>(stop - start).count();
+
+    std::printf("%8d %8u %12u %12zu %12.3f %12.1f %10zu\n",
+                layerCount,
+                graph.getNodeCount(),
+                graph.getConnectionCount(),
+                program.size(),
+                seconds * 1e3,
+                (g_peakBytes.load() - baseBytes) / 1024.0,
+                g_allocationCount.load());
+  }
+
+  return 0;
+}
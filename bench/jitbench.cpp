@@ -0,0 +1,118 @@
+/* Measures the time from a model to its first inference with the JIT, and compares its throughput to the interpreter.
+ *
+ * Each model is a dense input -> hidden -> output network of the given width. The JIT time covers emitting the code
+ * and mapping it, but not compiling the model to a program, which both backends share. */
+
+#include "benchmodels.h"
+#include "compiler.h"
+#include "graph.h"
+#include "interpreter.h"
+#include "jit.h"
+#include "model.h"
+#include "optimizer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+namespace {
+
+void
+relu(float* values, std::size_t count)
+{
+  for (std::size_t i = 0; i < count; i++)
+    values[i] = std::max(values[i], 0.0f);
+}
+
+template<typename Clock = std::chrono::steady_clock>
+auto
+elapsedSince(typename Clock::time_point start) -> double
+{
+  return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+} // namespace
+
+int
+main(int argc, char** argv)
+{
+  if (!JitProgram::isSupported()) {
+    std::printf("The JIT is not supported on this platform.\n");
+    return 0;
+  }
+
+  const int maxWidth = (argc > 1) ? std::atoi(argv[1]) : 256;
+
+  const int sampleCount = (argc > 2) ? std::atoi(argv[2]) : 4096;
+
+  std::printf("%8s %12s %10s %10s %12s %12s %10s\n", "width", "exprs", "jit us", "code KiB", "interp ms", "jit ms",
+              "max diff");
+
+  for (int width = 16; width <= maxWidth; width *= 2) {
+
+    Model model;
+
+    buildDenseModel(model, width);
+
+    Program program = Compiler(Graph(model)).compile();
+
+    optimize(program);
+
+    std::vector<float> parameters(program.getParameterCount());
+
+    for (std::size_t i = 0; i < parameters.size(); i++)
+      parameters[i] = static_cast<float>((i * 7919) % 2001) / 1000.0f - 1.0f;
+
+    std::vector<float> inputs(static_cast<std::size_t>(sampleCount) * program.getInputCount());
+
+    for (std::size_t i = 0; i < inputs.size(); i++)
+      inputs[i] = static_cast<float>((i * 104729) % 2001) / 1000.0f - 1.0f;
+
+    const std::size_t outputSize = static_cast<std::size_t>(sampleCount) * program.getOutputExprIndices().size();
+
+    std::vector<float> interpreterOutputs(outputSize);
+
+    std::vector<float> jitOutputs(outputSize);
+
+    auto start = std::chrono::steady_clock::now();
+
+    JitProgram jit(program, relu);
+
+    const double jitSeconds = elapsedSince(start);
+
+    Interpreter interpreter(program);
+
+    interpreter.setActivation(relu);
+
+    start = std::chrono::steady_clock::now();
+
+    interpreter.run(parameters.data(), inputs.data(), sampleCount, interpreterOutputs.data());
+
+    const double interpreterSeconds = elapsedSince(start);
+
+    start = std::chrono::steady_clock::now();
+
+    jit.run(parameters.data(), inputs.data(), sampleCount, jitOutputs.data());
+
+    const double runSeconds = elapsedSince(start);
+
+    float maxDiff = 0.0f;
+
+    for (std::size_t i = 0; i < outputSize; i++)
+      maxDiff = std::max(maxDiff, std::fabs(interpreterOutputs[i] - jitOutputs[i]));
+
+    std::printf("%8d %12zu %10.1f %10.1f %12.3f %12.3f %10g\n",
+                width,
+                program.size(),
+                jitSeconds * 1e6,
+                jit.getCodeSize() / 1024.0,
+                interpreterSeconds * 1e3,
+                runSeconds * 1e3,
+                maxDiff);
+  }
+
+  return 0;
+}
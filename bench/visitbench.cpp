@@ -0,0 +1,332 @@
+/* Compares the cost of walking a program with the different dispatch mechanisms.
+ *
+ * The workload is a use count analysis, which touches every operand of every instruction and does very little work
+ * per instruction, so the time is dominated by the dispatch itself. */
+
+#include "ir.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+namespace {
+
+/* The original representation: one heap allocated object per instruction, dispatched through two virtual calls. */
+namespace legacy {
+
+class Visitor;
+
+class Expr
+{
+public:
+  virtual ~Expr() = default;
+
+  virtual void accept(Visitor& visitor) const = 0;
+};
+
+class NullaryExpr;
+class UnaryExpr;
+class BinaryExpr;
+class TernaryExpr;
+
+class Visitor
+{
+public:
+  virtual ~Visitor() = default;
+
+  virtual void visit(const NullaryExpr&) = 0;
+
+  virtual void visit(const UnaryExpr&) = 0;
+
+  virtual void visit(const BinaryExpr&) = 0;
+
+  virtual void visit(const TernaryExpr&) = 0;
+};
+
+class NullaryExpr final : public Expr
+{
+public:
+  void accept(Visitor& visitor) const override { visitor.visit(*this); }
+};
+
+class UnaryExpr final : public Expr
+{
+public:
+  UnaryExpr(std::uint32_t a)
+    : m_a(a)
+  {}
+
+  void accept(Visitor& visitor) const override { visitor.visit(*this); }
+
+  std::uint32_t m_a;
+};
+
+class BinaryExpr final : public Expr
+{
+public:
+  BinaryExpr(std::uint32_t a, std::uint32_t b)
+    : m_a(a)
+    , m_b(b)
+  {}
+
+  void accept(Visitor& visitor) const override { visitor.visit(*this); }
+
+  std::uint32_t m_a;
+
+  std::uint32_t m_b;
+};
+
+class TernaryExpr final : public Expr
+{
+public:
+  TernaryExpr(std::uint32_t a, std::uint32_t b, std::uint32_t c)
+    : m_a(a)
+    , m_b(b)
+    , m_c(c)
+  {}
+
+  void accept(Visitor& visitor) const override { visitor.visit(*this); }
+
+  std::uint32_t m_a;
+
+  std::uint32_t m_b;
+
+  std::uint32_t m_c;
+};
+
+class UseCounter final : public Visitor
+{
+public:
+  explicit UseCounter(std::vector<std::uint32_t>& useCounts)
+    : m_useCounts(useCounts)
+  {}
+
+  void visit(const NullaryExpr&) override {}
+
+  void visit(const UnaryExpr& expr) override { m_useCounts[expr.m_a]++; }
+
+  void visit(const BinaryExpr& expr) override
+  {
+    m_useCounts[expr.m_a]++;
+    m_useCounts[expr.m_b]++;
+  }
+
+  void visit(const TernaryExpr& expr) override
+  {
+    m_useCounts[expr.m_a]++;
+    m_useCounts[expr.m_b]++;
+    m_useCounts[expr.m_c]++;
+  }
+
+private:
+  std::vector<std::uint32_t>& m_useCounts;
+};
+
+} // namespace legacy
+
+class VirtualUseCounter final : public ExprVisitor
+{
+public:
+  explicit VirtualUseCounter(std::vector<std::uint32_t>& useCounts)
+    : m_useCounts(useCounts)
+  {}
+
+  void visit(const ActivationExpr& expr) override { m_useCounts[expr.getInputExpr()]++; }
+
+  void visit(const AddExpr& expr) override
+  {
+    m_useCounts[expr.getInputExpr1()]++;
+    m_useCounts[expr.getInputExpr2()]++;
+  }
+
+  void visit(const MultiplyAddExpr& expr) override
+  {
+    m_useCounts[expr.getInputExpr1()]++;
+    m_useCounts[expr.getInputExpr2()]++;
+    m_useCounts[expr.getInputExpr3()]++;
+  }
+
+  void visit(const ZeroExpr&) override {}
+
+  void visit(const BiasExpr&) override {}
+
+  void visit(const WeightExpr&) override {}
+
+  void visit(const InputExpr&) override {}
+
+  void visit(const MatVecExpr& expr) override
+  {
+    for (std::uint32_t i = 0; i < expr.getColumnCount(); i++)
+      m_useCounts[expr.getInputExpr(i)]++;
+  }
+
+  void visit(const ElementExpr& expr) override { m_useCounts[expr.getVectorExpr()]++; }
+
+  void visit(const DotExpr& expr) override
+  {
+    for (std::uint32_t i = 0; i < expr.getTermCount(); i++)
+      m_useCounts[expr.getInputExpr(i)]++;
+  }
+
+private:
+  std::vector<std::uint32_t>& m_useCounts;
+};
+
+class UseCounter final
+{
+public:
+  explicit UseCounter(std::vector<std::uint32_t>& useCounts)
+    : m_useCounts(useCounts)
+  {}
+
+  void operator()(const ActivationExpr& expr) { m_useCounts[expr.getInputExpr()]++; }
+
+  void operator()(const AddExpr& expr)
+  {
+    m_useCounts[expr.getInputExpr1()]++;
+    m_useCounts[expr.getInputExpr2()]++;
+  }
+
+  void operator()(const MultiplyAddExpr& expr)
+  {
+    m_useCounts[expr.getInputExpr1()]++;
+    m_useCounts[expr.getInputExpr2()]++;
+    m_useCounts[expr.getInputExpr3()]++;
+  }
+
+  void operator()(const ZeroExpr&) {}
+
+  void operator()(const BiasExpr&) {}
+
+  void operator()(const WeightExpr&) {}
+
+  void operator()(const InputExpr&) {}
+
+  void operator()(const MatVecExpr& expr)
+  {
+    for (std::uint32_t i = 0; i < expr.getColumnCount(); i++)
+      m_useCounts[expr.getInputExpr(i)]++;
+  }
+
+  void operator()(const ElementExpr& expr) { m_useCounts[expr.getVectorExpr()]++; }
+
+  void operator()(const DotExpr& expr)
+  {
+    for (std::uint32_t i = 0; i < expr.getTermCount(); i++)
+      m_useCounts[expr.getInputExpr(i)]++;
+  }
+
+private:
+  std::vector<std::uint32_t>& m_useCounts;
+};
+
+/// @brief Builds a program shaped like the output of the compiler: a chain of multiply-adds per node.
+void
+buildPrograms(std::size_t exprCount, Program& program, std::vector<std::unique_ptr<legacy::Expr>>& legacyProgram)
+{
+  const std::uint32_t inputCount = 64;
+
+  program.reserve(exprCount + 64, exprCount * 2);
+
+  for (std::uint32_t i = 0; i < inputCount; i++) {
+    program.push<InputExpr>(i);
+    legacyProgram.emplace_back(new legacy::UnaryExpr(i));
+  }
+
+  std::uint32_t parameter = 0;
+
+  while (program.size() < exprCount) {
+
+    auto prev = program.push<ZeroExpr>();
+    legacyProgram.emplace_back(new legacy::NullaryExpr());
+
+    for (std::uint32_t i = 0; i < inputCount; i++) {
+      const auto b = program.push<BiasExpr>(parameter);
+      const auto w = program.push<WeightExpr>(parameter);
+      const auto m = program.push<MultiplyAddExpr>(i, b, w);
+      legacyProgram.emplace_back(new legacy::UnaryExpr(parameter));
+      legacyProgram.emplace_back(new legacy::UnaryExpr(parameter));
+      legacyProgram.emplace_back(new legacy::TernaryExpr(i, b, w));
+      legacyProgram.emplace_back(new legacy::BinaryExpr(prev, m));
+      prev = program.push<AddExpr>(prev, m);
+      parameter++;
+    }
+
+    program.addOutput(program.push<ActivationExpr>(prev));
+    legacyProgram.emplace_back(new legacy::UnaryExpr(prev));
+  }
+}
+
+template<typename Func>
+auto
+measure(const char* name, std::size_t exprCount, int repeatCount, Func func) -> double
+{
+  double best = 0;
+
+  for (int i = 0; i < repeatCount; i++) {
+
+    const auto start = std::chrono::steady_clock::now();
+
+    func();
+
+    const auto stop = std::chrono::steady_clock::now();
+
+    const double seconds = std::chrono::duration<double>(stop - start).count();
+
+    best = (i == 0) ? seconds : std::min(best, seconds);
+  }
+
+  std::printf("%-24s %10.3f ms %8.2f ns/expr\n", name, best * 1e3, (best * 1e9) / exprCount);
+
+  return best;
+}
+
+} // namespace
+
+int
+main(int argc, char** argv)
+{
+  const std::size_t requestedSize = (argc > 1) ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+
+  const int repeatCount = 10;
+
+  Program program;
+
+  std::vector<std::unique_ptr<legacy::Expr>> legacyProgram;
+
+  buildPrograms(requestedSize, program, legacyProgram);
+
+  const std::size_t exprCount = program.size();
+
+  std::printf("instructions: %zu\n", exprCount);
+
+  std::vector<std::uint32_t> useCounts(exprCount);
+
+  measure("legacy virtual visitor", exprCount, repeatCount, [&] {
+    legacy::UseCounter counter(useCounts);
+    for (const auto& expr : legacyProgram)
+      expr->accept(counter);
+  });
+
+  measure("flat virtual visitor", exprCount, repeatCount, [&] {
+    VirtualUseCounter counter(useCounts);
+    program.accept(counter);
+  });
+
+  measure("flat switch dispatch", exprCount, repeatCount, [&] {
+    UseCounter counter(useCounts);
+    visit(program, counter);
+  });
+
+  std::uint64_t checksum = 0;
+
+  for (const auto count : useCounts)
+    checksum += count;
+
+  std::printf("checksum: %llu\n", static_cast<unsigned long long>(checksum));
+
+  return 0;
+}
@@ -1,5 +1,7 @@
 #include "codegenerator.h"
 
+#include "textpatch.h"
+
 #include <QSyntaxStyle>
 
 #include <cassert>
@@ -27,7 +29,9 @@ CodeGenerator::CodeGenerator(QWidget* parent)
 void
 CodeGenerator::setCode(const QString& code)
 {
-  m_codeView.setPlainText(code);
+  patchPlainText(m_codeView, m_code, code);
+
+  m_code = code;
 }
 
 void
@@ -2,14 +2,16 @@
 #define CODEGENERATOR_H
 
 #include <QFormLayout>
+#include <QString>
 #include <QTextEdit>
 #include <QVBoxLayout>
 #include <QWidget>
 
 #include <QCodeEditor>
 
-class Model;
-class QString;
+#include <memory>
+
+class Program;
 
 class CodeGenerator : public QWidget
 {
@@ -19,7 +21,8 @@ public:
 
   virtual ~CodeGenerator() = default;
 
-  virtual void generate(const Model&) = 0;
+  /// @brief Starts generating code for a program. The program may be shared with a background thread.
+  virtual void generate(std::shared_ptr<const Program> program) = 0;
 
 signals:
   void propertiesChanged();
@@ -36,6 +39,9 @@ protected:
 private:
   QCodeEditor m_codeView{this};
 
+  /// @brief The text of the code view, to compare new code against.
+  QString m_code;
+
   QWidget m_form{ this };
 
   QVBoxLayout m_layout{ this };
@@ -1,174 +1,272 @@
 #include "compiler.h"
 
-#include "model.h"
+#include "graph.h"
 
-#include <QTextStream>
+#include <algorithm>
+#include <utility>
+
+#include <cassert>
 
 namespace {
 
-class Compiler final
+enum class VisitState : std::uint8_t
 {
-public:
-  Compiler(const Model& model)
-    : m_model(model)
-  {}
+  Unvisited,
+  Pending,
+  Done
+};
 
-  auto compile() -> Program
-  {
+constexpr std::uint32_t g_noLayer = 0xffffffff;
 
-    for (const auto& outputNode : m_model.getOutputNodes())
-    {
-      m_outputIndices.emplace_back(compileNode(*outputNode));
-    }
+} // namespace
 
-    return Program(std::move(m_exprs), std::move(m_outputIndices));
-  }
+Compiler::Compiler(GraphView graph)
+  : m_graph(graph)
+{}
 
-private:
-  auto pushExpr(Expr* expr) -> std::uint32_t
-  {
-    m_exprs.emplace_back(expr);
+auto
+Compiler::compile() -> Program
+{
+  sortNodes();
 
-    return m_exprs.size() - 1;
-  }
+  detectLayers();
 
-  auto compileNode(const Node& node) -> std::uint32_t
-  {
-    std::vector<std::uint32_t> inputs;
+  std::size_t exprCount = 0;
+  std::size_t operandCount = 0;
 
-    inputs.emplace_back(pushExpr(new ZeroExpr()));
+  countExprs(exprCount, operandCount);
 
-    for (const auto& connection : node.getConnections())
-    {
-      const auto prev = inputs.back();
+  m_program.reserve(exprCount, operandCount, m_graph.getOutputNodeCount());
 
-      const auto tmp = compileNode(*connection);
-      const auto b = pushExpr(new BiasExpr(0));
-      const auto w = pushExpr(new WeightExpr(0));
-      const auto result = pushExpr(new MultiplyAddExpr(tmp, b, w));
+  m_program.setInputCount(m_graph.getInputNodeCount());
 
-      inputs.emplace_back(pushExpr(new AddExpr(prev, result)));
-    }
+  /* Every connection of the graph gets a slot, including those that no output depends on, which are left unused. */
 
-    return pushExpr(new ActivationExpr(inputs.back()));
-  }
+  const auto connectionCount = m_graph.getConnectionCount();
 
-private:
-  const Model& m_model;
+  m_parameterLayout.weightOffset = 0;
+  m_parameterLayout.weightCount = connectionCount;
+  m_parameterLayout.biasOffset = connectionCount;
+  m_parameterLayout.biasCount = connectionCount;
 
-  ExprVector m_exprs;
+  m_program.setParameterLayout(m_parameterLayout);
 
-  std::vector<std::uint32_t> m_outputIndices;
-};
+  m_nodeExprs.assign(m_graph.getNodeCount(), 0);
 
-} // namespace
+  /* The rows of a layer are in the order of their IDs, which needn't be the order they are reached in. The layer is
+   * lowered when its first node is reached, since its inputs are all available by then. */
 
-CompilerWidget::CompilerWidget(QWidget* parent)
-  : QWidget(parent)
-{
-  m_layout.addWidget(&m_irView);
+  std::vector<bool> compiledLayers(m_layers.size(), false);
+
+  for (const auto node : m_order) {
+
+    const auto layerIndex = m_nodeLayers[node];
+
+    if (layerIndex == g_noLayer) {
+      m_nodeExprs[node] = compileNode(node);
+    } else if (!compiledLayers[layerIndex]) {
+      compileLayer(m_layers[layerIndex]);
+      compiledLayers[layerIndex] = true;
+    }
+  }
+
+  for (std::uint32_t i = 0; i < m_graph.getOutputNodeCount(); i++)
+    m_program.addOutput(m_nodeExprs[m_graph.getFirstOutputNode() + i]);
+
+  return std::move(m_program);
 }
 
 void
-CompilerWidget::compile(const Model& model)
+Compiler::sortNodes()
 {
-  Compiler compiler(model);
+  /* This is a depth first search from each output node, emitting nodes in post-order. An explicit stack keeps track of
+   * each pending node and the next of its connections to look at. */
 
-  m_program = compiler.compile();
+  const auto nodeCount = m_graph.getNodeCount();
 
-  updateIR();
+  std::vector<VisitState> states(nodeCount, VisitState::Unvisited);
 
-  emit programCompiled();
-}
+  std::vector<std::pair<std::uint32_t, std::uint32_t>> stack;
 
-namespace {
+  stack.reserve(nodeCount);
 
-class IRViewBuilder final : public ExprVisitor
-{
-public:
-  IRViewBuilder(QString* output)
-    : m_irStream(output)
-  {}
-
-  void visit(const ActivationExpr& activationExpr) override
-  {
-    m_irStream << reg(m_dstIndex) << " = activate " << reg(activationExpr.getInputExpr()) << "\n";
-    m_dstIndex++;
-  }
+  m_order.clear();
 
-  void visit(const AddExpr& addExpr) override
-  {
-    m_irStream << reg(m_dstIndex) << " = add " << reg(addExpr.getInputExpr1()) << " " << reg(addExpr.getInputExpr2()) << "\n";
-    m_dstIndex++;
-  }
+  m_order.reserve(nodeCount);
 
-  void visit(const MultiplyAddExpr& multiplyAddExpr) override
-  {
-    m_irStream << reg(m_dstIndex) << " <- madd";
-    m_irStream << ' ';
-    m_irStream << reg(multiplyAddExpr.getInputExpr1());
-    m_irStream << ' ';
-    m_irStream << reg(multiplyAddExpr.getInputExpr2());
-    m_irStream << ' ';
-    m_irStream << reg(multiplyAddExpr.getInputExpr3());
-    m_irStream << '\n';
-    m_dstIndex++;
-  }
+  for (auto root = m_graph.getFirstOutputNode(); root < nodeCount; root++) {
 
-  void visit(const InputExpr& inputExpr) override
-  {
-    m_irStream << reg(m_dstIndex) << " = input " << number(inputExpr.getInputIndex()) << "\n";
-    m_dstIndex++;
-  }
+    if (states[root] != VisitState::Unvisited)
+      continue;
 
-  void visit(const BiasExpr& biasExpr) override
-  {
-    m_irStream << reg(m_dstIndex) << " = bias " << number(biasExpr.getBiasIndex()) << "\n";
-    m_dstIndex++;
-  }
+    states[root] = VisitState::Pending;
+
+    stack.emplace_back(root, 0);
+
+    while (!stack.empty()) {
+
+      auto& top = stack.back();
 
-  void visit(const WeightExpr& weightExpr) override
-  {
-    m_irStream << reg(m_dstIndex) << " = weight " << number(weightExpr.getWeightIndex()) << "\n";
-    m_dstIndex++;
+      const auto node = top.first;
+
+      if (top.second < m_graph.getConnectionCount(node)) {
+
+        const auto next = m_graph.getConnections(node)[top.second++];
+
+        assert(states[next] != VisitState::Pending && "The model contains a cycle.");
+
+        if (states[next] == VisitState::Unvisited) {
+          states[next] = VisitState::Pending;
+          stack.emplace_back(next, 0);
+        }
+
+        continue;
+      }
+
+      states[node] = VisitState::Done;
+
+      stack.pop_back();
+
+      m_order.emplace_back(node);
+    }
   }
+}
 
-  void visit(const ZeroExpr& zeroExpr) override
-  {
-    m_irStream << reg(m_dstIndex) << " = zero\n";
-    m_dstIndex++;
+void
+Compiler::detectLayers()
+{
+  m_layers.clear();
+
+  m_nodeLayers.assign(m_graph.getNodeCount(), g_noLayer);
+
+  if (m_minLayerSize == 0)
+    return;
+
+  /* A layer reads the parameters of its rows as one matrix, so it is split into runs of nodes whose connections are
+   * next to each other in the graph. Nodes without connections may lie between them, which keeps the runs from
+   * depending on anything but the layout of the connections. */
+
+  const auto* connectionOffsets = m_graph.getConnectionOffsets();
+
+  for (const auto& layer : findLayers(m_graph, m_order, m_minLayerSize)) {
+
+    auto nodes = layer.getNodes();
+
+    std::sort(nodes.begin(), nodes.end());
+
+    const auto inputCount = static_cast<std::uint32_t>(layer.getInputs().size());
+
+    for (std::size_t first = 0; first < nodes.size();) {
+
+      auto last = first + 1;
+
+      while ((last < nodes.size()) &&
+             (connectionOffsets[nodes[last]] == (connectionOffsets[nodes[last - 1]] + inputCount)))
+        last++;
+
+      if ((last - first) >= m_minLayerSize) {
+        m_layers.emplace_back(std::vector<std::uint32_t>(nodes.begin() + first, nodes.begin() + last),
+                              layer.getInputs().data(),
+                              static_cast<std::uint32_t>(layer.getInputs().size()));
+      }
+
+      first = last;
+    }
   }
 
-private:
-  QString number(std::uint32_t value)
-  {
-    return QString::number(value);
+  for (std::uint32_t i = 0; i < m_layers.size(); i++) {
+    for (const auto node : m_layers[i].getNodes())
+      m_nodeLayers[node] = i;
   }
+}
 
-  QString reg(std::uint32_t value)
-  {
-    return QString("%") + QString::number(value);
+void
+Compiler::countExprs(std::size_t& exprCount, std::size_t& operandCount) const
+{
+  for (const auto node : m_order) {
+
+    const auto layerIndex = m_nodeLayers[node];
+
+    if (layerIndex != g_noLayer) {
+
+      const auto& layer = m_layers[layerIndex];
+
+      if (layer.getNodes().front() == node) {
+        const auto rowCount = layer.getNodes().size();
+        exprCount += 1 + (rowCount * 2);
+        operandCount += MatVecExpr::operandCount(layer.getInputs().size()) +
+                        (rowCount * (ElementExpr::operandCount() + ActivationExpr::operandCount()));
+      }
+
+    } else if (m_graph.getNodeKind(node) == NodeKind::Input) {
+      exprCount += 1;
+      operandCount += InputExpr::operandCount();
+    } else {
+      const std::size_t connectionCount = m_graph.getConnectionCount(node);
+      exprCount += 2 + (connectionCount * 4);
+      operandCount += ActivationExpr::operandCount() +
+                      (connectionCount * (BiasExpr::operandCount() + WeightExpr::operandCount() +
+                                          MultiplyAddExpr::operandCount() + AddExpr::operandCount()));
+    }
   }
+}
 
-private:
-  QTextStream m_irStream;
+auto
+Compiler::compileNode(std::uint32_t node) -> std::uint32_t
+{
+  /* Input nodes come first in the graph, so the ID of an input node is also its input index. */
 
-  std::uint32_t m_dstIndex = 0;
-};
+  if (m_graph.getNodeKind(node) == NodeKind::Input)
+    return m_program.push<InputExpr>(node);
 
-} // namespace
+  const auto* connections = m_graph.getConnections(node);
+
+  const auto connectionCount = m_graph.getConnectionCount(node);
+
+  const auto firstParameter = m_graph.getConnectionOffsets()[node];
+
+  auto prev = m_program.push<ZeroExpr>();
+
+  for (std::uint32_t i = 0; i < connectionCount; i++) {
+    const auto tmp = m_nodeExprs[connections[i]];
+    const auto b = m_program.push<BiasExpr>(m_parameterLayout.biasOffset + firstParameter + i);
+    const auto w = m_program.push<WeightExpr>(m_parameterLayout.weightOffset + firstParameter + i);
+    const auto result = m_program.push<MultiplyAddExpr>(tmp, b, w);
+
+    prev = m_program.push<AddExpr>(prev, result);
+  }
+
+  return m_program.push<ActivationExpr>(prev);
+}
 
 void
-CompilerWidget::updateIR()
+Compiler::compileLayer(const Layer& layer)
 {
-  QString ir;
+  /* The connections of the rows follow each other in the graph, and each row has the same number of them, so the
+   * weights (and biases) of the layer form a row-major matrix in the slots of their connections. */
 
-  IRViewBuilder builder(&ir);
+  const auto rowCount = static_cast<std::uint32_t>(layer.getNodes().size());
 
-  for (const auto &expr : m_program.getExprs())
-  {
-    expr->accept(builder);
-  }
+  const auto columnCount = static_cast<std::uint32_t>(layer.getInputs().size());
+
+  const auto firstParameter = m_graph.getConnectionOffsets()[layer.getNodes().front()];
+
+  auto& operands = m_operands;
 
-  m_irView.setPlainText(ir);
+  operands.clear();
+
+  operands.emplace_back(rowCount);
+  operands.emplace_back(columnCount);
+  operands.emplace_back(m_parameterLayout.weightOffset + firstParameter);
+  operands.emplace_back(m_parameterLayout.biasOffset + firstParameter);
+
+  for (const auto input : layer.getInputs())
+    operands.emplace_back(m_nodeExprs[input]);
+
+  const auto matVec = m_program.pushVariadic<MatVecExpr>(operands.data(), operands.size());
+
+  for (std::uint32_t i = 0; i < rowCount; i++) {
+    const auto element = m_program.push<ElementExpr>(matVec, i);
+    m_nodeExprs[layer.getNodes()[i]] = m_program.push<ActivationExpr>(element);
+  }
 }
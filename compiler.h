@@ -1,33 +1,72 @@
 #pragma once
 
-#include <QWidget>
-#include <QVBoxLayout>
-#include <QCodeEditor>
-
+#include "graph.h"
 #include "ir.h"
+#include "layer.h"
+
+#include <vector>
 
-class Model;
+#include <cstdint>
 
-class CompilerWidget : public QWidget
+/// @brief Lowers a model into a program.
+///
+/// @detail The nodes are first put into topological order, with the inputs of each node ahead of the node itself, and
+///         are then lowered one after the other in that order. Neither step is recursive, so the depth of the model
+///         is only limited by memory. Nodes that no output depends on are not lowered.
+///
+///         Groups of nodes that form a fully connected layer are lowered together, into a single @ref MatVecExpr.
+///
+///         The parameters of each connection are in the slot of its index in the graph, so the meaning of a parameter
+///         buffer only depends on the graph, and not on the options of the compiler or on which nodes are lowered.
+class Compiler final
 {
-  Q_OBJECT
 public:
-  explicit CompilerWidget(QWidget* parent);
+  /// @param graph The topology to compile. The model is required to be acyclic, which @ref Model::canConnect ensures.
+  ///              Only the view is kept, so the arrays it refers to have to outlive the compiler.
+  explicit Compiler(GraphView graph);
 
-  void compile(const Model&);
+  /// @brief Sets the number of nodes a layer needs before it is lowered as a matrix-vector product.
+  ///
+  /// @detail Smaller groups are lowered node by node. Setting this to zero disables layer detection.
+  void setMinLayerSize(std::uint32_t nodeCount) { m_minLayerSize = nodeCount; }
 
-  auto getProgram() const -> const Program& { return m_program; }
-
-signals:
-  void programCompiled();
+  auto compile() -> Program;
 
 private:
-  void updateIR();
+  /// @brief Computes @ref m_order.
+  void sortNodes();
+
+  /// @brief Finds the layers among the nodes in @ref m_order whose connections are next to each other in the graph,
+  ///        so that the parameters of their rows are too.
+  void detectLayers();
+
+  /// @brief Computes the exact size of the program that will be emitted.
+  void countExprs(std::size_t& exprCount, std::size_t& operandCount) const;
+
+  auto compileNode(std::uint32_t node) -> std::uint32_t;
+
+  void compileLayer(const Layer& layer);
 
 private:
+  GraphView m_graph;
+
   Program m_program;
 
-  QVBoxLayout m_layout{this};
+  /// @brief The nodes to lower, in the order to lower them.
+  std::vector<std::uint32_t> m_order;
+
+  /// @brief The instruction holding the result of each node that has been lowered so far, indexed by node ID.
+  std::vector<std::uint32_t> m_nodeExprs;
+
+  std::vector<Layer> m_layers;
+
+  /// @brief The index of the layer each node belongs to, if any, indexed by node ID.
+  std::vector<std::uint32_t> m_nodeLayers;
+
+  std::uint32_t m_minLayerSize = 2;
+
+  /// @brief Scratch space for building instructions with a variable number of operands.
+  std::vector<std::uint32_t> m_operands;
 
-  QCodeEditor m_irView{this};
+  ParameterLayout m_parameterLayout;
 };
@@ -0,0 +1,109 @@
+#include "compilerwidget.h"
+
+#include "compiler.h"
+#include "graph.h"
+#include "irprinter.h"
+#include "model.h"
+#include "optimizer.h"
+#include "regalloc.h"
+#include "textpatch.h"
+
+#include <QTextStream>
+
+#include <utility>
+#include <vector>
+
+namespace {
+
+/// @brief What a background compile produces.
+struct CompileResult final
+{
+  std::shared_ptr<const Program> program;
+
+  QString ir;
+};
+
+auto
+printIR(const Program& program, const std::vector<PassReport>& passReports) -> QString
+{
+  QString ir;
+
+  QTextStream stream(&ir);
+
+  for (const auto& report : passReports)
+    stream << "; " << report.name << ": removed " << report.removedCount << " instructions\n";
+
+  const auto allocation = RegisterAllocator(program).allocate();
+
+  stream << "; registers: " << allocation.slotCount << " slots, peak live " << allocation.peakLiveCount << "\n";
+
+  stream << '\n';
+
+  stream.flush();
+
+  ir += printProgram(program);
+
+  return ir;
+}
+
+} // namespace
+
+CompilerWidget::CompilerWidget(const Model& model, QWidget* parent)
+  : QWidget(parent)
+  , m_compiler(model)
+  , m_program(std::make_shared<const Program>())
+{
+  m_layout.addWidget(&m_irView);
+
+  /* The compiler learns about each edit as it happens, so that by the time compile is called it knows whether any of
+   * them matters. */
+
+  connect(&model, &Model::nodeAdded, this, [this](Node* node) { m_compiler.nodeAdded(node); });
+
+  connect(&model, &Model::nodeRemoved, this, [this](Node* node) { m_compiler.nodeRemoved(node); });
+
+  connect(&model, &Model::connectionAdded, this, [this](Node* node, Node* input) {
+    m_compiler.connectionAdded(node, input);
+  });
+
+  compile();
+}
+
+void
+CompilerWidget::compile()
+{
+  std::shared_ptr<const Graph> graph = m_compiler.takeSnapshot();
+
+  if (!graph)
+    return;
+
+  /* The checks between the stages let a superseded compile stop early. Its result is thrown away either way. */
+
+  auto job = [graph](const BackgroundWorker::IsCancelled& isCancelled) -> CompileResult {
+    auto program = std::make_shared<Program>(Compiler(*graph).compile());
+
+    if (isCancelled())
+      return CompileResult();
+
+    const auto passReports = optimize(*program);
+
+    if (isCancelled())
+      return CompileResult();
+
+    QString ir = printIR(*program, passReports);
+
+    return CompileResult{ std::move(program), std::move(ir) };
+  };
+
+  auto done = [this](CompileResult&& result) {
+    m_program = std::move(result.program);
+
+    patchPlainText(m_irView, m_ir, result.ir);
+
+    m_ir = std::move(result.ir);
+
+    emit programCompiled();
+  };
+
+  m_worker.run<CompileResult>(this, job, done);
+}
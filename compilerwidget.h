@@ -0,0 +1,52 @@
+#pragma once
+
+#include <QWidget>
+#include <QVBoxLayout>
+#include <QCodeEditor>
+
+#include "backgroundworker.h"
+#include "incrementalcompiler.h"
+#include "ir.h"
+
+#include <QString>
+
+#include <memory>
+
+class Model;
+
+/// @brief Shows the program of a model, compiling it again when asked to after an edit of the model has changed it.
+///
+/// @detail When to compile is left to the owner, which can wait for a burst of edits to end first. Compiling happens
+///         on a background thread, on a snapshot of the model, so the model can be edited while a large one compiles.
+///         Compiling again in the meantime cancels the compile that is still running.
+class CompilerWidget : public QWidget
+{
+  Q_OBJECT
+public:
+  CompilerWidget(const Model& model, QWidget* parent);
+
+  /// @brief Starts bringing the program up to date with the model, if an edit has changed it. @ref programCompiled is
+  ///        emitted once the new program is available.
+  void compile();
+
+  /// @brief Gets the latest program that has finished compiling. It can be shared with other threads.
+  auto getProgram() const -> std::shared_ptr<const Program> { return m_program; }
+
+signals:
+  void programCompiled();
+
+private:
+  IncrementalCompiler m_compiler;
+
+  std::shared_ptr<const Program> m_program;
+
+  /// @brief The text of the IR view, to compare new listings against.
+  QString m_ir;
+
+  QVBoxLayout m_layout{this};
+
+  QCodeEditor m_irView{this};
+
+  /// @brief This is the last member, so that it is destroyed first and the job it runs can't outlive the others.
+  BackgroundWorker m_worker;
+};
@@ -1,11 +1,13 @@
 #ifndef CXXCODEGENERATOR_H
 #define CXXCODEGENERATOR_H
 
+#include "backgroundworker.h"
 #include "codegenerator.h"
+#include "cxxemitter.h"
 
+#include <QComboBox>
 #include <QLineEdit>
 #include <QString>
-#include <QStringList>
 
 #include <QCXXHighlighter>
 
@@ -15,21 +17,33 @@ class CxxCodeGenerator : public CodeGenerator
 {
   Q_OBJECT
 public:
+  using SimdTarget = CxxEmitter::SimdTarget;
+
+  using NumberFormat = CxxEmitter::NumberFormat;
+
   explicit CxxCodeGenerator(QWidget* parent = nullptr);
 
-  void generate(const Model& model) override;
+  /// @brief Starts generating code on a background thread. A program given before this one finishes is cancelled.
+  void generate(std::shared_ptr<const Program> program) override;
 
 private:
-  auto getModelClassName() const -> QString;
+  auto getNumberFormat() const -> NumberFormat;
 
-  auto beginFuncDef(const QString& funcName, const QStringList& params, const QString& result) -> QString;
+  auto getSimdTarget() const -> SimdTarget;
 
 private:
   QLineEdit m_namespaceEdit{ getFormWidget() };
 
   QLineEdit m_modelEdit{ getFormWidget() };
 
+  QComboBox m_numberFormatEdit{ getFormWidget() };
+
+  QComboBox m_simdEdit{ getFormWidget() };
+
   QCXXHighlighter m_highlighter;
+
+  /// @brief This is the last member, so that it is destroyed first and the job it runs can't outlive the others.
+  BackgroundWorker m_worker;
 };
 
 #endif // CXXCODEGENERATOR_H
@@ -0,0 +1,1076 @@
+#include "cxxemitter.h"
+
+#include "ir.h"
+#include "regalloc.h"
+
+#include <QTextStream>
+
+#include <vector>
+
+namespace {
+
+/// @brief Describes how the dot product kernels are written with the intrinsics of one SIMD target.
+///
+/// @detail In the expressions, %1, %2 and %3 are replaced by the operands, in the order listed next to each member.
+struct SimdSyntax final
+{
+  /// @brief The preprocessor condition that holds when the generated code is compiled for the target.
+  const char* condition;
+
+  /// @brief What to tell the user when the condition does not hold.
+  const char* requirement;
+
+  /// @brief The header declaring the intrinsics, if any.
+  const char* header;
+
+  /// @brief Declarations placed at the start of each kernel.
+  const char* prologue;
+
+  const char* vectorType;
+
+  int laneCount;
+
+  const char* zero;
+
+  /// @brief Loads lanes from a pointer which is not necessarily aligned. (pointer)
+  const char* load;
+
+  /// @brief (accumulator, value)
+  const char* add;
+
+  /// @brief (accumulator, value 1, value 2)
+  const char* multiplyAdd;
+
+  /// @brief Statements that declare "result" as the sum of the lanes of "acc".
+  const char* reduce;
+};
+
+auto
+getSimdSyntax(CxxEmitter::SimdTarget target) -> const SimdSyntax*
+{
+  using SimdTarget = CxxEmitter::SimdTarget;
+
+  static const SimdSyntax vectorExtensions{
+    "defined(__GNUC__)",
+    "GCC or Clang",
+    nullptr,
+    "    typedef float vector_type __attribute__((vector_size(32), aligned(4), __may_alias__));\n",
+    "vector_type",
+    8,
+    "vector_type{}",
+    "*reinterpret_cast<const vector_type*>(%1)",
+    "%1 + %2",
+    "%1 + %2 * %3",
+    "    float result = 0.0f;\n"
+    "    for (int k = 0; k < 8; k++)\n"
+    "      result += acc[k];\n",
+  };
+
+  static const SimdSyntax sse{
+    "defined(__SSE__)",
+    "SSE (for example -msse)",
+    "immintrin.h",
+    nullptr,
+    "__m128",
+    4,
+    "_mm_setzero_ps()",
+    "_mm_loadu_ps(%1)",
+    "_mm_add_ps(%1, %2)",
+    "_mm_add_ps(%1, _mm_mul_ps(%2, %3))",
+    "    acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));\n"
+    "    acc = _mm_add_ss(acc, _mm_shuffle_ps(acc, acc, 1));\n"
+    "    float result = _mm_cvtss_f32(acc);\n",
+  };
+
+  static const SimdSyntax avx2{
+    "defined(__AVX2__) && defined(__FMA__)",
+    "AVX2 and FMA (for example -mavx2 -mfma)",
+    "immintrin.h",
+    nullptr,
+    "__m256",
+    8,
+    "_mm256_setzero_ps()",
+    "_mm256_loadu_ps(%1)",
+    "_mm256_add_ps(%1, %2)",
+    "_mm256_fmadd_ps(%2, %3, %1)",
+    "    __m128 half = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));\n"
+    "    half = _mm_add_ps(half, _mm_movehl_ps(half, half));\n"
+    "    half = _mm_add_ss(half, _mm_shuffle_ps(half, half, 1));\n"
+    "    float result = _mm_cvtss_f32(half);\n",
+  };
+
+  static const SimdSyntax avx512{
+    "defined(__AVX512F__)",
+    "AVX-512F (for example -mavx512f)",
+    "immintrin.h",
+    nullptr,
+    "__m512",
+    16,
+    "_mm512_setzero_ps()",
+    "_mm512_loadu_ps(%1)",
+    "_mm512_add_ps(%1, %2)",
+    "_mm512_fmadd_ps(%2, %3, %1)",
+    "    float result = _mm512_reduce_add_ps(acc);\n",
+  };
+
+  static const SimdSyntax neon{
+    "defined(__ARM_NEON)",
+    "NEON",
+    "arm_neon.h",
+    nullptr,
+    "float32x4_t",
+    4,
+    "vdupq_n_f32(0.0f)",
+    "vld1q_f32(%1)",
+    "vaddq_f32(%1, %2)",
+    "vmlaq_f32(%1, %2, %3)",
+    "    float32x2_t half = vadd_f32(vget_low_f32(acc), vget_high_f32(acc));\n"
+    "    float result = vget_lane_f32(vpadd_f32(half, half), 0);\n",
+  };
+
+  switch (target) {
+    case SimdTarget::None:
+      break;
+    case SimdTarget::VectorExtensions:
+      return &vectorExtensions;
+    case SimdTarget::Sse:
+      return &sse;
+    case SimdTarget::Avx2:
+      return &avx2;
+    case SimdTarget::Avx512:
+      return &avx512;
+    case SimdTarget::Neon:
+      return &neon;
+  }
+
+  return nullptr;
+}
+
+/// @brief Emits one kernel that accumulates whole vectors of lanes and finishes the remainder with scalar code.
+///
+/// @detail Two accumulators are used in the main loop, so that each step doesn't have to wait for the previous one.
+///
+/// @param name The name of the kernel.
+///
+/// @param binary Whether the kernel takes the dot product of two arrays, rather than the sum of one.
+void
+emitSimdKernel(QTextStream& stream, const SimdSyntax& syntax, const char* name, bool binary)
+{
+  if (binary)
+    stream << "  static auto " << name << "(const float* a, const float* b, size_type n) noexcept -> float\n";
+  else
+    stream << "  static auto " << name << "(const float* a, size_type n) noexcept -> float\n";
+
+  stream << "  {\n";
+
+  if (syntax.prologue)
+    stream << syntax.prologue;
+
+  const QString load(syntax.load);
+
+  auto step = [&](const char* accumulator, const QString& offset) {
+    const QString a = load.arg(QString("a + ") + offset);
+    const QString b = load.arg(QString("b + ") + offset);
+    return binary ? QString(syntax.multiplyAdd).arg(accumulator, a, b) : QString(syntax.add).arg(accumulator, a);
+  };
+
+  const int laneCount = syntax.laneCount;
+
+  const QString secondOffset = QString("(i + %1)").arg(laneCount);
+
+  stream << "    " << syntax.vectorType << " acc0 = " << syntax.zero << ";\n";
+  stream << "    " << syntax.vectorType << " acc1 = " << syntax.zero << ";\n";
+  stream << "    const size_type end = n - (n % " << (laneCount * 2) << ");\n";
+  stream << "    size_type i = 0;\n";
+  stream << "    for (; i < end; i += " << (laneCount * 2) << ") {\n";
+  stream << "      acc0 = " << step("acc0", "i") << ";\n";
+  stream << "      acc1 = " << step("acc1", secondOffset) << ";\n";
+  stream << "    }\n";
+  stream << "    if ((n - i) >= " << laneCount << ") {\n";
+  stream << "      acc0 = " << step("acc0", "i") << ";\n";
+  stream << "      i += " << laneCount << ";\n";
+  stream << "    }\n";
+  stream << "    " << syntax.vectorType << " acc = " << QString(syntax.add).arg("acc0", "acc1") << ";\n";
+  stream << syntax.reduce;
+  stream << "    for (; i < n; i++)\n";
+  stream << "      result += " << (binary ? "a[i] * b[i]" : "a[i]") << ";\n";
+  stream << "    return result;\n";
+  stream << "  }\n";
+}
+
+/// @brief Emits the kernels used to compute matrix-vector products.
+///
+/// @detail The generic versions work for any scalar type. When a SIMD target is selected, overloads for single
+///         precision floats are added, which overload resolution prefers over the templates.
+void
+emitKernels(QTextStream& stream, const SimdSyntax* syntax)
+{
+  /* Four partial sums, added up as a tree, break the dependency between consecutive terms. */
+
+  stream << "  template <typename T>\n";
+  stream << "  static constexpr auto dot(const T* a, const T* b, size_type n) noexcept -> T\n";
+  stream << "  {\n";
+  stream << "    T s0 = T(0), s1 = T(0), s2 = T(0), s3 = T(0);\n";
+  stream << "    const size_type end = n - (n % 4);\n";
+  stream << "    size_type i = 0;\n";
+  stream << "    for (; i < end; i += 4) {\n";
+  stream << "      s0 += a[i] * b[i];\n";
+  stream << "      s1 += a[i + 1] * b[i + 1];\n";
+  stream << "      s2 += a[i + 2] * b[i + 2];\n";
+  stream << "      s3 += a[i + 3] * b[i + 3];\n";
+  stream << "    }\n";
+  stream << "    for (; i < n; i++)\n";
+  stream << "      s0 += a[i] * b[i];\n";
+  stream << "    return (s0 + s1) + (s2 + s3);\n";
+  stream << "  }\n";
+  stream << '\n';
+  stream << "  template <typename T>\n";
+  stream << "  static constexpr auto sum(const T* a, size_type n) noexcept -> T\n";
+  stream << "  {\n";
+  stream << "    T s0 = T(0), s1 = T(0), s2 = T(0), s3 = T(0);\n";
+  stream << "    const size_type end = n - (n % 4);\n";
+  stream << "    size_type i = 0;\n";
+  stream << "    for (; i < end; i += 4) {\n";
+  stream << "      s0 += a[i];\n";
+  stream << "      s1 += a[i + 1];\n";
+  stream << "      s2 += a[i + 2];\n";
+  stream << "      s3 += a[i + 3];\n";
+  stream << "    }\n";
+  stream << "    for (; i < n; i++)\n";
+  stream << "      s0 += a[i];\n";
+  stream << "    return (s0 + s1) + (s2 + s3);\n";
+  stream << "  }\n";
+
+  if (!syntax)
+    return;
+
+  stream << '\n';
+  emitSimdKernel(stream, *syntax, "dot", true);
+  stream << '\n';
+  emitSimdKernel(stream, *syntax, "sum", false);
+}
+
+/// @brief Emits the kernels used by the quantized model to compute matrix-vector products.
+void
+emitQuantizedKernels(QTextStream& stream)
+{
+  stream << "  static constexpr auto dot(const value_type* a, const value_type* b, size_type n) noexcept\n";
+  stream << "    -> accumulator_type\n";
+  stream << "  {\n";
+  stream << "    accumulator_type result = 0;\n";
+  stream << "    for (size_type i = 0; i < n; i++)\n";
+  stream << "      result += accumulator_type(a[i]) * b[i];\n";
+  stream << "    return result;\n";
+  stream << "  }\n";
+  stream << '\n';
+  stream << "  static constexpr auto sum(const accumulator_type* a, size_type n) noexcept -> accumulator_type\n";
+  stream << "  {\n";
+  stream << "    accumulator_type result = 0;\n";
+  stream << "    for (size_type i = 0; i < n; i++)\n";
+  stream << "      result += a[i];\n";
+  stream << "    return result;\n";
+  stream << "  }\n";
+  stream << '\n';
+}
+
+/// @brief Emits the functions that take the sum of a node to its output scale and then to 8 bits.
+///
+/// @detail The multiplier is a fraction with 31 bits after the point. The product is rounded to nearest when it is
+///         shifted right, and saturated to 32 bits in case the scale grows.
+void
+emitRequantization(QTextStream& stream)
+{
+  stream << "  constexpr auto requantize(accumulator_type value, size_type index) const noexcept -> accumulator_type\n";
+  stream << "  {\n";
+  stream << "    const std::int64_t multiplier = m_requantization[index * 2];\n";
+  stream << "    const int shift = static_cast<int>(m_requantization[(index * 2) + 1]);\n";
+  stream << "    const std::int64_t rounding = (shift > 0) ? (std::int64_t(1) << (shift - 1)) : 0;\n";
+  stream << "    const std::int64_t scaled = ((value * multiplier) + rounding) >> shift;\n";
+  stream << "    if (scaled > INT32_MAX)\n";
+  stream << "      return INT32_MAX;\n";
+  stream << "    if (scaled < INT32_MIN)\n";
+  stream << "      return INT32_MIN;\n";
+  stream << "    return static_cast<accumulator_type>(scaled);\n";
+  stream << "  }\n";
+  stream << '\n';
+  stream << "  static constexpr auto saturate(accumulator_type value) noexcept -> value_type\n";
+  stream << "  {\n";
+  stream << "    if (value > INT8_MAX)\n";
+  stream << "      return INT8_MAX;\n";
+  stream << "    if (value < INT8_MIN)\n";
+  stream << "      return INT8_MIN;\n";
+  stream << "    return static_cast<value_type>(value);\n";
+  stream << "  }\n";
+}
+
+auto
+countActivations(const Program& program) -> std::uint32_t
+{
+  std::uint32_t count = 0;
+
+  for (std::uint32_t i = 0; i < program.size(); i++) {
+    if (program.getOpcode(i) == Opcode::Activation)
+      count++;
+  }
+
+  return count;
+}
+
+auto
+usesKernels(const Program& program) -> bool
+{
+  for (std::uint32_t i = 0; i < program.size(); i++) {
+    if ((program.getOpcode(i) == Opcode::MatVec) || (program.getOpcode(i) == Opcode::Dot))
+      return true;
+  }
+
+  return false;
+}
+
+/// @brief The number of samples that the batched entry point evaluates together.
+const std::uint32_t g_batchBlockSize = 16;
+
+/// @brief The register class of node values.
+const std::uint32_t g_valueClass = 0;
+
+/// @brief The register class of sums, when they are wider than node values.
+const std::uint32_t g_accumulatorClass = 1;
+
+/// @brief Emits one statement per instruction that computes something.
+///
+/// @detail Zeros, inputs, weights and biases are not given locals of their own. They are written in place wherever
+///         they are used, which keeps the number of locals down to the instructions that do arithmetic. Those locals are
+///         assigned by the @ref RegisterAllocator, so a local is reused once the value it held is no longer needed and
+///         the number of locals follows the peak number of live values rather than the size of the program.
+///
+///         In batched mode, each local is an array with one lane per sample of the block and each statement becomes a
+///         loop over the lanes. Weights and biases stay scalars, so they are loaded once for the whole block.
+///
+///         In quantized mode, node outputs are 8-bit values and everything feeding a node is accumulated in 32 bits.
+///         Each activation is preceded by a requantization step and followed by saturation to 8 bits.
+class CxxExprEmitter final
+{
+public:
+  CxxExprEmitter(QTextStream& stream, const Program& program, bool batched, bool quantized)
+    : m_stream(stream)
+    , m_program(program)
+    , m_aliases(program.size())
+    , m_batched(batched)
+    , m_quantized(quantized)
+  {
+    /* Adding zero is common, since each node starts out as zero, but it can't be folded away by the C++ compiler for
+     * floating point types. Such additions are emitted as the other operand, and so is anything that only names a
+     * value held elsewhere. Neither needs a register. */
+
+    std::vector<std::uint32_t> classes(program.size(), RegisterAllocation::noRegister);
+
+    for (std::uint32_t i = 0; i < program.size(); i++) {
+
+      m_aliases[i] = i;
+
+      const std::uint32_t* operands = program.getOperands(i);
+
+      switch (program.getOpcode(i)) {
+        case Opcode::Zero:
+        case Opcode::Input:
+        case Opcode::Weight:
+        case Opcode::Bias:
+        case Opcode::Element:
+          break;
+        case Opcode::Activation:
+          classes[i] = g_valueClass;
+          break;
+        case Opcode::Add:
+          if (isZero(operands[0]))
+            m_aliases[i] = m_aliases[operands[1]];
+          else if (isZero(operands[1]))
+            m_aliases[i] = m_aliases[operands[0]];
+          else
+            classes[i] = accumulatorClass();
+          break;
+        case Opcode::MultiplyAdd:
+        case Opcode::MatVec:
+        case Opcode::Dot:
+          classes[i] = accumulatorClass();
+          break;
+      }
+    }
+
+    RegisterAllocator allocator(program);
+
+    allocator.setRegisterClasses(std::move(classes));
+
+    m_allocation = allocator.allocate();
+  }
+
+  /// @brief Declares one local for each register, ahead of the instructions that assign to them.
+  ///
+  /// @return Whether anything was declared.
+  auto declareRegisters() -> bool
+  {
+    std::vector<bool> declared(m_allocation.slotCount, false);
+
+    bool any = false;
+
+    for (std::uint32_t i = 0; i < m_program.size(); i++) {
+
+      const std::uint32_t slot = m_allocation.exprSlots[i];
+
+      if ((slot == RegisterAllocation::noRegister) || declared[slot])
+        continue;
+
+      declared[slot] = true;
+
+      any = true;
+
+      const char* type = (m_program.getOpcode(i) == Opcode::Activation) ? valueType() : accumulatorType();
+
+      const std::uint32_t size = m_program.getResultSize(i);
+
+      m_stream << (m_batched ? "    " : "  ") << type << " s" << slot;
+
+      if (m_program.getOpcode(i) == Opcode::MatVec)
+        m_stream << '[' << size << ']';
+
+      m_stream << (m_batched ? "[block_size];\n" : "{};\n");
+    }
+
+    return any;
+  }
+
+  void operator()(const ZeroExpr&) { next(); }
+
+  void operator()(const InputExpr&) { next(); }
+
+  void operator()(const WeightExpr&) { next(); }
+
+  void operator()(const BiasExpr&) { next(); }
+
+  void operator()(const AddExpr& expr)
+  {
+    if (m_aliases[m_dstIndex] != m_dstIndex)
+      return next();
+
+    beginAssignment() << operand(expr.getInputExpr1()) << " + " << operand(expr.getInputExpr2()) << ";\n";
+
+    next();
+  }
+
+  void operator()(const MultiplyAddExpr& expr)
+  {
+    /* In quantized mode, the input is widened first so that the product is computed in the accumulator type. */
+
+    auto& stream = beginAssignment();
+
+    if (m_quantized)
+      stream << "accumulator_type(" << operand(expr.getInputExpr1()) << ')';
+    else
+      stream << operand(expr.getInputExpr1());
+
+    stream << " * " << operand(expr.getInputExpr3()) << " + " << operand(expr.getInputExpr2()) << ";\n";
+
+    next();
+  }
+
+  void operator()(const ActivationExpr& expr)
+  {
+    if (m_quantized) {
+      beginAssignment() << "saturate(activation(requantize(" << operand(expr.getInputExpr()) << ", "
+                        << m_activationIndex << ")));\n";
+      m_activationIndex++;
+    } else {
+      beginAssignment() << "activation(" << operand(expr.getInputExpr()) << ");\n";
+    }
+
+    next();
+  }
+
+  void operator()(const MatVecExpr& expr)
+  {
+    if (m_batched)
+      emitBatchedMatVec(expr);
+    else
+      emitMatVec(expr);
+
+    next();
+  }
+
+  void operator()(const ElementExpr&) { next(); }
+
+  void operator()(const DotExpr& expr)
+  {
+    if (m_batched)
+      emitBatchedDot(expr);
+    else
+      emitDot(expr);
+
+    next();
+  }
+
+  /// @brief Gets the C++ expression for the result of an instruction.
+  ///
+  /// @detail In batched mode, this is the expression for lane "k" of the result.
+  auto operand(std::uint32_t exprIndex) const -> QString
+  {
+    exprIndex = m_aliases[exprIndex];
+
+    const std::uint32_t* operands = m_program.getOperands(exprIndex);
+
+    const char* lane = m_batched ? "[k]" : "";
+
+    switch (m_program.getOpcode(exprIndex)) {
+      case Opcode::Zero:
+        return QString("%1(0)").arg(accumulatorType());
+      case Opcode::Input:
+        return QString("x%1%2").arg(operands[0]).arg(lane);
+      case Opcode::Weight:
+        return QString("%1[%2]").arg(weightArray()).arg(weightIndex(operands[0]));
+      case Opcode::Bias:
+        return QString("%1[%2]").arg(biasArray()).arg(biasIndex(operands[0]));
+      case Opcode::Element:
+        return QString("%1[%2]%3").arg(registerName(operands[0])).arg(operands[1]).arg(lane);
+      default:
+        break;
+    }
+
+    return registerName(exprIndex) + lane;
+  }
+
+private:
+  void emitMatVec(const MatVecExpr& expr)
+  {
+    /* The inputs are gathered into an array first, so that each row is a dot product of two arrays. Since every
+     * connection has its own bias, the biases of a row are summed up separately. */
+
+    const auto rowCount = expr.getRowCount();
+    const auto columnCount = expr.getColumnCount();
+
+    m_stream << "  {\n";
+
+    emitGather(columnCount, [&expr](std::uint32_t i) { return expr.getInputExpr(i); });
+
+    m_stream << "    for (size_type i = 0; i < " << rowCount << "; i++) {\n";
+    m_stream << "      const auto* w = " << weightArray() << " + " << weightIndex(expr.getWeightOffset()) << " + (i * "
+             << columnCount << ");\n";
+    m_stream << "      const auto* b = " << biasArray() << " + " << biasIndex(expr.getBiasOffset()) << " + (i * "
+             << columnCount << ");\n";
+    m_stream << "      " << registerName(m_dstIndex) << "[i] = dot(w, columns, " << columnCount << ") + sum(b, "
+             << columnCount << ");\n";
+    m_stream << "    }\n";
+    m_stream << "  }\n";
+  }
+
+  void emitDot(const DotExpr& expr)
+  {
+    const auto termCount = expr.getTermCount();
+
+    m_stream << "  {\n";
+
+    emitGather(termCount, [&expr](std::uint32_t i) { return expr.getInputExpr(i); });
+
+    m_stream << "    " << registerName(m_dstIndex) << " = dot(" << weightArray() << " + "
+             << weightIndex(expr.getWeightOffset()) << ", columns, " << termCount << ") + sum(" << biasArray() << " + "
+             << biasIndex(expr.getBiasOffset()) << ", " << termCount << ");\n";
+    m_stream << "  }\n";
+  }
+
+  void emitBatchedMatVec(const MatVecExpr& expr)
+  {
+    /* Here the inputs are gathered as pointers to their lanes. Each weight is then loaded once and multiplied with
+     * every lane of its input, which is the loop that the C++ compiler vectorizes. */
+
+    const auto rowCount = expr.getRowCount();
+    const auto columnCount = expr.getColumnCount();
+
+    m_stream << "    {\n";
+
+    emitBatchedGather(columnCount, [&expr](std::uint32_t i) { return expr.getInputExpr(i); });
+
+    m_stream << "      for (size_type i = 0; i < " << rowCount << "; i++) {\n";
+    m_stream << "        const auto* w = " << weightArray() << " + " << weightIndex(expr.getWeightOffset())
+             << " + (i * " << columnCount << ");\n";
+    m_stream << "        const auto bias = sum(" << biasArray() << " + " << biasIndex(expr.getBiasOffset())
+             << " + (i * " << columnCount << "), " << columnCount << ");\n";
+    m_stream << "        " << accumulatorType() << "* y = " << registerName(m_dstIndex) << "[i];\n";
+
+    emitBatchedAccumulation("        ", columnCount);
+
+    m_stream << "      }\n";
+    m_stream << "    }\n";
+  }
+
+  void emitBatchedDot(const DotExpr& expr)
+  {
+    const auto termCount = expr.getTermCount();
+
+    m_stream << "    {\n";
+
+    emitBatchedGather(termCount, [&expr](std::uint32_t i) { return expr.getInputExpr(i); });
+
+    m_stream << "      const auto* w = " << weightArray() << " + " << weightIndex(expr.getWeightOffset()) << ";\n";
+    m_stream << "      const auto bias = sum(" << biasArray() << " + " << biasIndex(expr.getBiasOffset()) << ", "
+             << termCount << ");\n";
+    m_stream << "      " << accumulatorType() << "* y = " << registerName(m_dstIndex) << ";\n";
+
+    emitBatchedAccumulation("      ", termCount);
+
+    m_stream << "    }\n";
+  }
+
+  /// @brief Declares an array named "columns" holding the values of a number of instructions.
+  template<typename GetInput>
+  void emitGather(std::uint32_t count, GetInput getInput)
+  {
+    m_stream << "    const " << valueType() << " columns[" << count << "]{";
+
+    for (std::uint32_t i = 0; i < count; i++) {
+      m_stream << (((i % 8) == 0) ? "\n      " : " ") << operand(getInput(i));
+      if ((i + 1) < count)
+        m_stream << ',';
+    }
+
+    m_stream << "\n    };\n";
+  }
+
+  /// @brief Declares an array named "columns" holding pointers to the lanes of a number of instructions.
+  template<typename GetInput>
+  void emitBatchedGather(std::uint32_t count, GetInput getInput)
+  {
+    bool hasZeroInput = false;
+
+    for (std::uint32_t i = 0; i < count; i++)
+      hasZeroInput |= isZero(getInput(i));
+
+    if (hasZeroInput)
+      m_stream << "      const " << valueType() << " zero[block_size]{};\n";
+
+    m_stream << "      const " << valueType() << "* columns[" << count << "]{";
+
+    for (std::uint32_t i = 0; i < count; i++) {
+      const auto inputExpr = getInput(i);
+      m_stream << (((i % 8) == 0) ? "\n        " : " ") << (isZero(inputExpr) ? "zero" : lanes(inputExpr));
+      if ((i + 1) < count)
+        m_stream << ',';
+    }
+
+    m_stream << "\n      };\n";
+  }
+
+  /// @brief Accumulates the products of the weights "w" and the lanes of "columns" into the lanes of "y".
+  ///
+  /// @detail Two products are added together before they are added to the lane, which halves the length of the chain
+  ///         of additions into each lane.
+  void emitBatchedAccumulation(const char* indent, std::uint32_t count)
+  {
+    const char* weight = m_quantized ? "accumulator_type(w[j])" : "w[j]";
+    const char* nextWeight = m_quantized ? "accumulator_type(w[j + 1])" : "w[j + 1]";
+
+    m_stream << indent << "for (size_type k = 0; k < m; k++)\n";
+    m_stream << indent << "  y[k] = bias;\n";
+    m_stream << indent << "size_type j = 0;\n";
+    m_stream << indent << "for (; (j + 2) <= " << count << "; j += 2) {\n";
+    m_stream << indent << "  const auto* x0 = columns[j];\n";
+    m_stream << indent << "  const auto* x1 = columns[j + 1];\n";
+    m_stream << indent << "  for (size_type k = 0; k < m; k++)\n";
+    m_stream << indent << "    y[k] += (" << weight << " * x0[k]) + (" << nextWeight << " * x1[k]);\n";
+    m_stream << indent << "}\n";
+
+    if ((count % 2) != 0) {
+      m_stream << indent << "for (size_type k = 0; k < m; k++)\n";
+      m_stream << indent << "  y[k] += " << weight << " * columns[j][k];\n";
+    }
+  }
+
+  /// @brief Gets the C++ expression for the lane array of an instruction, in batched mode.
+  auto lanes(std::uint32_t exprIndex) const -> QString
+  {
+    exprIndex = m_aliases[exprIndex];
+
+    const std::uint32_t* operands = m_program.getOperands(exprIndex);
+
+    switch (m_program.getOpcode(exprIndex)) {
+      case Opcode::Input:
+        return QString("x%1").arg(operands[0]);
+      case Opcode::Element:
+        return QString("%1[%2]").arg(registerName(operands[0])).arg(operands[1]);
+      default:
+        break;
+    }
+
+    return registerName(exprIndex);
+  }
+
+  /// @brief Gets the name of the local holding the register of an instruction.
+  auto registerName(std::uint32_t exprIndex) const -> QString
+  {
+    return QString("s%1").arg(m_allocation.exprSlots[exprIndex]);
+  }
+
+  auto isZero(std::uint32_t exprIndex) const -> bool
+  {
+    return m_program.getOpcode(m_aliases[exprIndex]) == Opcode::Zero;
+  }
+
+  auto beginAssignment() -> QTextStream&
+  {
+    if (m_batched) {
+      m_stream << "    for (size_type k = 0; k < m; k++)\n";
+      m_stream << "      " << registerName(m_dstIndex) << "[k] = ";
+    } else {
+      m_stream << "  " << registerName(m_dstIndex) << " = ";
+    }
+
+    return m_stream;
+  }
+
+  /// @brief Gets the register class of sums. In quantized mode, they are wider than the values of nodes.
+  auto accumulatorClass() const -> std::uint32_t { return m_quantized ? g_accumulatorClass : g_valueClass; }
+
+  /// @brief Gets the type of node outputs.
+  auto valueType() const -> const char* { return m_quantized ? "value_type" : "Scalar"; }
+
+  /// @brief Gets the type of the sums that feed into nodes.
+  auto accumulatorType() const -> const char* { return m_quantized ? "accumulator_type" : "Scalar"; }
+
+  /// @brief Gets the array that weights are read from.
+  auto weightArray() const -> const char* { return m_quantized ? "m_weights" : "m_connections"; }
+
+  /// @brief Gets the array that biases are read from.
+  auto biasArray() const -> const char* { return m_quantized ? "m_biases" : "m_connections"; }
+
+  /// @brief Maps the position of a weight in the parameter layout to its position in the weight array.
+  auto weightIndex(std::uint32_t parameterIndex) const -> std::uint32_t
+  {
+    return m_quantized ? (parameterIndex - m_program.getParameterLayout().weightOffset) : parameterIndex;
+  }
+
+  /// @brief Maps the position of a bias in the parameter layout to its position in the bias array.
+  auto biasIndex(std::uint32_t parameterIndex) const -> std::uint32_t
+  {
+    return m_quantized ? (parameterIndex - m_program.getParameterLayout().biasOffset) : parameterIndex;
+  }
+
+  void next() { m_dstIndex++; }
+
+private:
+  QTextStream& m_stream;
+
+  const Program& m_program;
+
+  /// @brief Maps each instruction to the instruction whose result it is equal to, usually itself.
+  std::vector<std::uint32_t> m_aliases;
+
+  /// @brief The register of each instruction. Each register is a local, reused once its value is no longer needed.
+  RegisterAllocation m_allocation;
+
+  bool m_batched;
+
+  bool m_quantized;
+
+  /// @brief The number of activations emitted so far, which is the index of their requantization parameters.
+  std::uint32_t m_activationIndex = 0;
+
+  std::uint32_t m_dstIndex = 0;
+};
+
+} // namespace
+
+auto
+CxxEmitter::generate(const Program& program) const -> QString
+{
+  QString code;
+
+  QTextStream stream(&code);
+
+  const auto inputCount = program.getInputCount();
+
+  const auto outputCount = program.getOutputExprIndices().size();
+
+  const bool quantized = m_numberFormat == NumberFormat::Int8;
+
+  /* The quantized model has fixed types, so it is not a template. */
+
+  const QString className = getModelClassName();
+
+  const QString qualifiedName = quantized ? className : (className + "<Scalar>");
+
+  const char* templateHead = quantized ? "" : "template <typename Scalar>\n";
+
+  const char* valueType = quantized ? "value_type" : "Scalar";
+
+  stream << "/* Note: This file is automatically generated. Edits made could potentially be lost. */\n";
+
+  stream << '\n';
+
+  stream << "#pragma once\n";
+
+  stream << '\n';
+
+  /* The SIMD kernels are written for floats, the quantized kernels are left to the auto-vectorizer. */
+
+  const SimdSyntax* simdSyntax = quantized ? nullptr : getSimdSyntax(m_simdTarget);
+
+  if (quantized) {
+    stream << "#include <cstdint>\n";
+    stream << '\n';
+  }
+
+  if (simdSyntax) {
+    stream << "#if !(" << simdSyntax->condition << ")\n";
+    stream << "#error \"This model was generated for a SIMD target that requires " << simdSyntax->requirement
+           << ".\"\n";
+    stream << "#endif\n";
+    stream << '\n';
+    if (simdSyntax->header) {
+      stream << "#include <" << simdSyntax->header << ">\n";
+      stream << '\n';
+    }
+  }
+
+  if (m_namespace.isEmpty())
+    stream << "namespace {\n";
+  else
+    stream << "namespace " << m_namespace << " {\n";
+
+  if (quantized) {
+    stream << R"(
+/** @brief Describes a neural network model, quantized to 8-bit integers.
+ *
+ * @detail Inputs, outputs and the value of each node are 8-bit integers, and the sums feeding each node are
+ *         accumulated in 32-bit integers. Before the activation of a node is applied, its sum is requantized to the
+ *         scale of the node's output. The activation function is called with that 32-bit value and must return a value
+ *         in the same scale, which is then saturated to 8 bits. Scale invariant functions, such as ReLU or a clamp,
+ *         can therefore be used as they are.
+ *
+ *         The parameters and scales are produced by calibrating the floating point model with a quantizer.
+ */
+)";
+  } else {
+    stream << R"(
+/** @brief Describes a neural network model.
+ *
+ * @tparam Scalar The type used to represent scalar values.
+ *                On platforms with floating point units, this is ideally a single precision float.
+ *                On embedded platforms without FPUs, this may be a custom soft float type. For integer arithmetic, the
+ *                model should be generated with the quantized number format instead.
+ */
+)";
+  }
+
+  stream << templateHead;
+  stream << "class " << className << " final\n";
+  stream << "{\n";
+  stream << "public:\n";
+  stream << "  using size_type = unsigned long int;\n";
+
+  if (quantized) {
+    stream << '\n';
+    stream << "  using value_type = std::int8_t;\n";
+    stream << '\n';
+    stream << "  using accumulator_type = std::int32_t;\n";
+  }
+
+  stream << '\n';
+  stream << "  static constexpr auto input_count() noexcept -> size_type { return " << inputCount << "; }\n";
+  stream << '\n';
+  stream << "  static constexpr auto output_count() noexcept -> size_type { return " << outputCount << "; }\n";
+  stream << '\n';
+  stream << "  static constexpr auto connection_count() noexcept -> size_type { return "
+         << program.getParameterLayout().weightCount << "; }\n";
+  stream << '\n';
+
+  if (quantized) {
+    stream << "  static constexpr auto activation_count() noexcept -> size_type { return "
+           << countActivations(program) << "; }\n";
+
+    stream << R"(
+/** @brief Constructs an instance of the model.
+ *
+ * @detail The model allows client code to take care of memory allocation.
+ *
+ * @param w_buf The buffer containing the weight of each connection. See @ref connection_count for its size.
+ * @param b_buf The buffer containing the bias of each connection. See @ref connection_count for its size.
+ * @param r_buf The buffer containing, for each activation, the fixed point multiplier and the right shift that
+ *              requantize its input. See @ref activation_count for the number of pairs in this buffer.
+ */
+)";
+
+    stream << "  constexpr " << className
+           << "(const value_type* w_buf, const accumulator_type* b_buf, const accumulator_type* r_buf) noexcept\n";
+    stream << "    : m_weights(w_buf)\n";
+    stream << "    , m_biases(b_buf)\n";
+    stream << "    , m_requantization(r_buf)\n";
+    stream << "  {}\n";
+  } else {
+    stream << "  static constexpr auto parameter_count() noexcept -> size_type { return " << program.getParameterCount()
+           << "; }\n";
+
+    stream << R"(
+/** @brief Constructs an instance of the model.
+ *
+ * @detail The model allows client code to take care of memory allocation.
+ *
+ * @param c_buf The buffer containing the weight of each connection, followed by the bias of each connection.
+ *              See @ref parameter_count for the required size of this buffer.
+ */
+)";
+
+    stream << "  constexpr " << className << "(const Scalar* c_buf) noexcept\n";
+    stream << "    : m_connections(c_buf)\n";
+    stream << "  {}\n";
+  }
+  stream << "\n";
+  stream << "  template <typename InputIterator,\n";
+  stream << "            typename OutputIterator,\n";
+  stream << "            typename Activation>\n";
+  stream << "  constexpr void operator()(InputIterator begin,\n";
+  stream << "                            InputIterator end,\n";
+  stream << "                            OutputIterator result,\n";
+  stream << "                            Activation activation) const;\n";
+
+  stream << R"(
+/** @brief Evaluates the model over a batch of samples.
+ *
+ * @detail The samples are evaluated in blocks of @ref block_size, with each operation applied to every sample of the
+ *         block before moving on to the next. This loads each parameter once per block and gives the C++ compiler loops
+ *         over samples that it can vectorize.
+ *
+ * @param in The input values, stored feature-major. Input "i" of sample "s" is at "in[i * n + s]".
+ * @param n The number of samples in the batch.
+ * @param out The output values, stored the same way as the inputs. Output "o" of sample "s" is at "out[o * n + s]".
+ */
+)";
+
+  stream << "  template <typename Activation>\n";
+  stream << "  void run_batch(const " << valueType << "* in, size_type n, " << valueType
+         << "* out, Activation activation) const;\n";
+  stream << '\n';
+  stream << "  static constexpr size_type block_size = " << g_batchBlockSize << ";\n";
+  stream << '\n';
+  stream << "private:\n";
+
+  if (quantized) {
+    if (usesKernels(program))
+      emitQuantizedKernels(stream);
+    emitRequantization(stream);
+    stream << '\n';
+    stream << "  const value_type* m_weights;\n";
+    stream << '\n';
+    stream << "  const accumulator_type* m_biases;\n";
+    stream << '\n';
+    stream << "  const accumulator_type* m_requantization;\n";
+  } else {
+    if (usesKernels(program)) {
+      emitKernels(stream, simdSyntax);
+      stream << '\n';
+    }
+    stream << "  const Scalar* m_connections;\n";
+  }
+
+  stream << "};\n";
+
+  stream << '\n';
+  stream << "/* Implementation details beyond this point. */\n";
+  stream << '\n';
+
+  const QString paramIndent(qualifiedName.size() + 28, ' ');
+
+  stream << templateHead;
+  stream << "template <typename InputIterator,\n";
+  stream << "          typename OutputIterator,\n";
+  stream << "          typename Activation>\n";
+  stream << "constexpr void " << qualifiedName << "::operator()(InputIterator begin,\n";
+  stream << paramIndent << "InputIterator end,\n";
+  stream << paramIndent << "OutputIterator result,\n";
+  stream << paramIndent << "Activation activation) const\n";
+  stream << "{\n";
+  stream << "  static_cast<void>(end);\n";
+
+  if (inputCount > 0)
+    stream << '\n';
+
+  for (std::uint32_t i = 0; i < inputCount; i++) {
+    stream << "  const " << valueType << " x" << i << " = *begin;\n";
+    stream << "  ++begin;\n";
+  }
+
+  stream << '\n';
+
+  CxxExprEmitter emitter(stream, program, /*batched=*/false, quantized);
+
+  if (emitter.declareRegisters())
+    stream << '\n';
+
+  visit(program, emitter);
+
+  if (!program.empty())
+    stream << '\n';
+
+  for (const auto outputExpr : program.getOutputExprIndices()) {
+    stream << "  *result = " << emitter.operand(outputExpr) << ";\n";
+    stream << "  ++result;\n";
+  }
+
+  stream << "}\n";
+
+  stream << '\n';
+
+  stream << templateHead;
+  stream << "template <typename Activation>\n";
+  stream << "void " << qualifiedName << "::run_batch(const " << valueType << "* in, size_type n, " << valueType
+         << "* out, Activation activation) const\n";
+  stream << "{\n";
+
+  if (inputCount == 0)
+    stream << "  static_cast<void>(in);\n";
+
+  stream << "  for (size_type base = 0; base < n; base += block_size) {\n";
+  stream << "    const size_type m = ((n - base) < block_size) ? (n - base) : block_size;\n";
+
+  if (inputCount > 0)
+    stream << '\n';
+
+  for (std::uint32_t i = 0; i < inputCount; i++)
+    stream << "    const " << valueType << "* x" << i << " = in + (" << i << " * n) + base;\n";
+
+  stream << '\n';
+
+  CxxExprEmitter batchEmitter(stream, program, /*batched=*/true, quantized);
+
+  if (batchEmitter.declareRegisters())
+    stream << '\n';
+
+  visit(program, batchEmitter);
+
+  if (!program.empty())
+    stream << '\n';
+
+  const auto& outputExprs = program.getOutputExprIndices();
+
+  for (std::uint32_t i = 0; i < outputExprs.size(); i++) {
+    stream << "    for (size_type k = 0; k < m; k++)\n";
+    stream << "      out[(" << i << " * n) + base + k] = " << batchEmitter.operand(outputExprs[i]) << ";\n";
+  }
+
+  stream << "  }\n";
+  stream << "}\n";
+
+  stream << '\n';
+
+  if (m_namespace.isEmpty())
+    stream << "} // namespace\n";
+  else
+    stream << "} // namespace " << m_namespace << '\n';
+
+  stream << '\n';
+
+  stream.flush();
+
+  return code;
+}
+
+auto
+CxxEmitter::getModelClassName() const -> QString
+{
+  return m_modelClassName.isEmpty() ? "basic_model" : m_modelClassName;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <QString>
+
+class Program;
+
+/// @brief Generates a C++ header for a program.
+///
+/// @detail This is the code generator behind @ref CxxCodeGenerator, without any user interface, so that it can be used
+///         from tools that run without a display.
+class CxxEmitter final
+{
+public:
+  /// @brief The instruction sets that the dot products of the generated code can be written for.
+  ///
+  /// @detail The order matches the entries of the combo box in the form of @ref CxxCodeGenerator.
+  enum class SimdTarget
+  {
+    None,
+    VectorExtensions,
+    Sse,
+    Avx2,
+    Avx512,
+    Neon
+  };
+
+  /// @brief The number formats that the generated code can compute with.
+  enum class NumberFormat
+  {
+    /// @brief The model is a template over the scalar type.
+    Scalar,
+    /// @brief Values are 8-bit integers, accumulated in 32 bits. See @ref Quantizer for producing the parameters, or
+    ///        the --calibration option of nngen-cli.
+    Int8
+  };
+
+  /// @brief Sets the namespace that the model is placed in. When empty, an anonymous namespace is used.
+  void setNamespace(const QString& name) { m_namespace = name; }
+
+  /// @brief Sets the name of the model class. When empty, the class is called "basic_model".
+  void setModelClassName(const QString& name) { m_modelClassName = name; }
+
+  void setNumberFormat(NumberFormat numberFormat) { m_numberFormat = numberFormat; }
+
+  void setSimdTarget(SimdTarget simdTarget) { m_simdTarget = simdTarget; }
+
+  auto generate(const Program& program) const -> QString;
+
+private:
+  auto getModelClassName() const -> QString;
+
+private:
+  QString m_namespace;
+
+  QString m_modelClassName;
+
+  NumberFormat m_numberFormat = NumberFormat::Scalar;
+
+  SimdTarget m_simdTarget = SimdTarget::None;
+};
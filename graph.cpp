@@ -0,0 +1,125 @@
+#include "graph.h"
+
+#include "node.h"
+
+#include <algorithm>
+#include <utility>
+
+Graph::Graph(const Model& model)
+  : Graph(model.getInputNodes(), model.getHiddenNodes(), model.getOutputNodes())
+{}
+
+Graph::Graph(const Node::NodeVector& inputNodes,
+             const Node::NodeVector& hiddenNodes,
+             const Node::NodeVector& outputNodes)
+  : m_inputNodeCount(inputNodes.size())
+  , m_hiddenNodeCount(hiddenNodes.size())
+  , m_outputNodeCount(outputNodes.size())
+{
+  /* A sorted table is used to look up node IDs, since it needs a single allocation no matter how many nodes there
+   * are. */
+
+  using NodeID = std::pair<const Node*, std::uint32_t>;
+
+  std::vector<NodeID> nodeIDs;
+
+  nodeIDs.reserve(getNodeCount());
+
+  const Node::NodeVector* nodeVectors[3]{ &inputNodes, &hiddenNodes, &outputNodes };
+
+  for (const auto* nodes : nodeVectors) {
+    for (const auto& node : *nodes)
+      nodeIDs.emplace_back(node.get(), static_cast<std::uint32_t>(nodeIDs.size()));
+  }
+
+  std::sort(nodeIDs.begin(), nodeIDs.end());
+
+  m_connectionOffsets.reserve(getNodeCount() + 1);
+
+  std::size_t connectionCount = 0;
+
+  for (const auto* nodes : nodeVectors) {
+    for (const auto& node : *nodes)
+      connectionCount += node->getConnections().size();
+  }
+
+  m_connections.reserve(connectionCount);
+
+  for (const auto* nodes : nodeVectors) {
+
+    for (const auto& node : *nodes) {
+
+      for (const auto& connection : node->getConnections()) {
+        const auto it = std::lower_bound(nodeIDs.begin(), nodeIDs.end(), NodeID(connection.get(), 0));
+        if ((it != nodeIDs.end()) && (it->first == connection.get()))
+          m_connections.emplace_back(it->second);
+      }
+
+      m_connectionOffsets.emplace_back(static_cast<std::uint32_t>(m_connections.size()));
+    }
+  }
+}
+
+auto
+Graph::getNodeKind(std::uint32_t node) const noexcept -> NodeKind
+{
+  if (node < m_inputNodeCount)
+    return NodeKind::Input;
+  else if (node < getFirstOutputNode())
+    return NodeKind::Hidden;
+  else
+    return NodeKind::Output;
+}
+
+auto
+hasCycle(const GraphView& graph) -> bool
+{
+  const auto nodeCount = graph.getNodeCount();
+
+  std::vector<std::uint32_t> userOffsets(nodeCount + 1, 0);
+
+  for (std::uint32_t node = 0; node < nodeCount; node++) {
+    for (std::uint32_t i = 0; i < graph.getConnectionCount(node); i++)
+      userOffsets[graph.getConnections(node)[i] + 1]++;
+  }
+
+  for (std::uint32_t node = 0; node < nodeCount; node++)
+    userOffsets[node + 1] += userOffsets[node];
+
+  std::vector<std::uint32_t> users(userOffsets[nodeCount]);
+
+  std::vector<std::uint32_t> cursors(userOffsets.begin(), userOffsets.end() - 1);
+
+  std::vector<std::uint32_t> remainingInputs(nodeCount);
+
+  std::vector<std::uint32_t> ready;
+
+  for (std::uint32_t node = 0; node < nodeCount; node++) {
+
+    for (std::uint32_t i = 0; i < graph.getConnectionCount(node); i++)
+      users[cursors[graph.getConnections(node)[i]]++] = node;
+
+    remainingInputs[node] = graph.getConnectionCount(node);
+
+    if (remainingInputs[node] == 0)
+      ready.emplace_back(node);
+  }
+
+  std::uint32_t doneCount = 0;
+
+  while (!ready.empty()) {
+
+    const auto node = ready.back();
+
+    ready.pop_back();
+
+    doneCount++;
+
+    for (std::uint32_t i = userOffsets[node]; i < userOffsets[node + 1]; i++) {
+      if (--remainingInputs[users[i]] == 0)
+        ready.emplace_back(users[i]);
+    }
+  }
+
+  return doneCount != nodeCount;
+}
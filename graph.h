@@ -0,0 +1,156 @@
+#pragma once
+
+#include "model.h"
+
+#include <vector>
+
+#include <cstdint>
+
+/// @brief A flattened, read-only copy of the topology of a model.
+///
+/// @detail Nodes are numbered densely: input nodes first, then hidden nodes, then output nodes, each in the order the
+///         model keeps them. The connections of each node are stored in compressed sparse row form, so the graph can
+///         be walked without touching the node objects or chasing shared pointers.
+class Graph final
+{
+public:
+  Graph() = default;
+
+  /// @brief Takes a snapshot of the model's topology.
+  ///
+  /// @note Connections to nodes that are no longer part of the model are left out.
+  explicit Graph(const Model& model);
+
+  /// @brief Takes a snapshot of nodes that are not, or not yet, part of a model.
+  Graph(const Node::NodeVector& inputNodes, const Node::NodeVector& hiddenNodes, const Node::NodeVector& outputNodes);
+
+  auto getNodeCount() const noexcept -> std::uint32_t
+  {
+    return m_inputNodeCount + m_hiddenNodeCount + m_outputNodeCount;
+  }
+
+  auto getInputNodeCount() const noexcept -> std::uint32_t { return m_inputNodeCount; }
+
+  auto getHiddenNodeCount() const noexcept -> std::uint32_t { return m_hiddenNodeCount; }
+
+  auto getOutputNodeCount() const noexcept -> std::uint32_t { return m_outputNodeCount; }
+
+  /// @brief Gets the ID of the first output node. The output nodes occupy the IDs from here to the end.
+  auto getFirstOutputNode() const noexcept -> std::uint32_t { return m_inputNodeCount + m_hiddenNodeCount; }
+
+  auto getNodeKind(std::uint32_t node) const noexcept -> NodeKind;
+
+  auto getConnectionCount() const noexcept -> std::uint32_t { return static_cast<std::uint32_t>(m_connections.size()); }
+
+  auto getConnectionCount(std::uint32_t node) const noexcept -> std::uint32_t
+  {
+    return m_connectionOffsets[node + 1] - m_connectionOffsets[node];
+  }
+
+  /// @brief Gets the IDs of the nodes that the given node takes its input from.
+  auto getConnections(std::uint32_t node) const noexcept -> const std::uint32_t*
+  {
+    return m_connections.data() + m_connectionOffsets[node];
+  }
+
+  /// @brief Gets the start of the connections of each node, followed by the total number of connections.
+  auto getConnectionOffsets() const noexcept -> const std::uint32_t* { return m_connectionOffsets.data(); }
+
+private:
+  std::uint32_t m_inputNodeCount = 0;
+
+  std::uint32_t m_hiddenNodeCount = 0;
+
+  std::uint32_t m_outputNodeCount = 0;
+
+  std::vector<std::uint32_t> m_connectionOffsets{ 0 };
+
+  std::vector<std::uint32_t> m_connections;
+};
+
+/// @brief A read-only graph whose arrays are owned by something else, such as a @ref Graph or a mapped model file.
+///
+/// @detail It has the same accessors as @ref Graph, and is what the compiler consumes, so that a graph stored in a
+///         file can be compiled in place. A view is only valid for as long as the arrays it points to.
+class GraphView final
+{
+public:
+  /// @param connectionOffsets The start of the connections of each node, followed by the total connection count.
+  ///
+  /// @param connections The IDs of the nodes that each node takes its input from.
+  GraphView(std::uint32_t inputNodeCount,
+            std::uint32_t hiddenNodeCount,
+            std::uint32_t outputNodeCount,
+            const std::uint32_t* connectionOffsets,
+            const std::uint32_t* connections) noexcept
+    : m_inputNodeCount(inputNodeCount)
+    , m_hiddenNodeCount(hiddenNodeCount)
+    , m_outputNodeCount(outputNodeCount)
+    , m_connectionOffsets(connectionOffsets)
+    , m_connections(connections)
+  {}
+
+  /// @brief Views a graph. This is implicit, so that a graph can be passed wherever a view is expected.
+  GraphView(const Graph& graph) noexcept
+    : GraphView(graph.getInputNodeCount(),
+                graph.getHiddenNodeCount(),
+                graph.getOutputNodeCount(),
+                graph.getConnectionOffsets(),
+                graph.getConnections(0))
+  {}
+
+  auto getNodeCount() const noexcept -> std::uint32_t
+  {
+    return m_inputNodeCount + m_hiddenNodeCount + m_outputNodeCount;
+  }
+
+  auto getInputNodeCount() const noexcept -> std::uint32_t { return m_inputNodeCount; }
+
+  auto getHiddenNodeCount() const noexcept -> std::uint32_t { return m_hiddenNodeCount; }
+
+  auto getOutputNodeCount() const noexcept -> std::uint32_t { return m_outputNodeCount; }
+
+  auto getFirstOutputNode() const noexcept -> std::uint32_t { return m_inputNodeCount + m_hiddenNodeCount; }
+
+  auto getNodeKind(std::uint32_t node) const noexcept -> NodeKind
+  {
+    if (node < m_inputNodeCount)
+      return NodeKind::Input;
+    else if (node < getFirstOutputNode())
+      return NodeKind::Hidden;
+    else
+      return NodeKind::Output;
+  }
+
+  auto getConnectionCount() const noexcept -> std::uint32_t { return m_connectionOffsets[getNodeCount()]; }
+
+  auto getConnectionCount(std::uint32_t node) const noexcept -> std::uint32_t
+  {
+    return m_connectionOffsets[node + 1] - m_connectionOffsets[node];
+  }
+
+  auto getConnections(std::uint32_t node) const noexcept -> const std::uint32_t*
+  {
+    return m_connections + m_connectionOffsets[node];
+  }
+
+  auto getConnectionOffsets() const noexcept -> const std::uint32_t* { return m_connectionOffsets; }
+
+private:
+  std::uint32_t m_inputNodeCount;
+
+  std::uint32_t m_hiddenNodeCount;
+
+  std::uint32_t m_outputNodeCount;
+
+  const std::uint32_t* m_connectionOffsets;
+
+  const std::uint32_t* m_connections;
+};
+
+/// @brief Checks whether the connections of a graph form a cycle, by peeling off the nodes whose inputs are all done.
+///
+/// @detail The compiler assumes that there are none, so graphs from outside of a @ref Model have to be checked with
+///         this first. Every connection has to refer to an existing node.
+auto
+hasCycle(const GraphView& graph) -> bool;
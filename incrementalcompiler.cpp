@@ -0,0 +1,130 @@
+#include "incrementalcompiler.h"
+
+#include "graph.h"
+#include "model.h"
+#include "node.h"
+
+#include <cstdint>
+
+IncrementalCompiler::IncrementalCompiler(const Model& model)
+  : m_model(model)
+{}
+
+void
+IncrementalCompiler::nodeAdded(const Node* node)
+{
+  /* A new hidden node has nothing depending on it, unless it was added along with the nodes that do, in which case
+   * they include an output and are marked below. Its own connections still move the parameter slots of the nodes
+   * after it, though. New inputs and outputs always change the program. */
+
+  switch (node->getKind()) {
+    case NodeKind::Input:
+      m_dirty = true;
+      break;
+    case NodeKind::Hidden:
+      if (!node->getConnections().empty())
+        m_dirty = true;
+      break;
+    case NodeKind::Output:
+      m_dirty = true;
+      markLive(node);
+      break;
+  }
+}
+
+void
+IncrementalCompiler::nodeRemoved(const Node* node)
+{
+  /* Removing an input renumbers the ones after it, and removing a node with connections renumbers the parameter slots
+   * after them, so both change the program even if nothing depends on the node. Only outputs connect to hidden nodes,
+   * so nothing else loses a connection when a hidden node that isn't live is removed. */
+
+  if ((node->getKind() == NodeKind::Input) || (m_liveNodes.count(node) > 0) || !node->getConnections().empty())
+    m_dirty = true;
+}
+
+void
+IncrementalCompiler::connectionAdded(const Node* node, const Node* input)
+{
+  /* Every connection takes a parameter slot, so a new one changes the program wherever it is. */
+
+  m_dirty = true;
+
+  if (m_liveNodes.count(node) > 0)
+    markLive(input);
+}
+
+auto
+IncrementalCompiler::takeSnapshot() -> std::shared_ptr<const Graph>
+{
+  if (!m_dirty)
+    return nullptr;
+
+  auto snapshot = std::make_shared<const Graph>(m_model);
+
+  const Graph& graph = *snapshot;
+
+  /* The live nodes are found again from the graph, which leaves out connections to nodes that have been removed. */
+
+  const auto nodeCount = graph.getNodeCount();
+
+  std::vector<bool> live(nodeCount, false);
+
+  std::vector<std::uint32_t> pending;
+
+  for (std::uint32_t node = graph.getFirstOutputNode(); node < nodeCount; node++) {
+    live[node] = true;
+    pending.emplace_back(node);
+  }
+
+  while (!pending.empty()) {
+
+    const auto node = pending.back();
+
+    pending.pop_back();
+
+    for (std::uint32_t i = 0; i < graph.getConnectionCount(node); i++) {
+      const auto input = graph.getConnections(node)[i];
+      if (!live[input]) {
+        live[input] = true;
+        pending.emplace_back(input);
+      }
+    }
+  }
+
+  m_liveNodes.clear();
+
+  std::uint32_t node = 0;
+
+  for (const auto* nodes : { &m_model.getInputNodes(), &m_model.getHiddenNodes(), &m_model.getOutputNodes() }) {
+    for (const auto& n : *nodes) {
+      if (live[node++])
+        m_liveNodes.insert(n.get());
+    }
+  }
+
+  m_dirty = false;
+
+  return snapshot;
+}
+
+void
+IncrementalCompiler::markLive(const Node* node)
+{
+  if (!m_liveNodes.insert(node).second)
+    return;
+
+  m_pendingNodes.emplace_back(node);
+
+  while (!m_pendingNodes.empty()) {
+
+    const auto* n = m_pendingNodes.back();
+
+    m_pendingNodes.pop_back();
+
+    for (const auto& input : n->getConnections()) {
+      if (m_liveNodes.insert(input.get()).second)
+        m_pendingNodes.emplace_back(input.get());
+    }
+  }
+}
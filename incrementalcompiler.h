@@ -0,0 +1,63 @@
+#pragma once
+
+#include <memory>
+#include <unordered_set>
+#include <vector>
+
+class Graph;
+class Model;
+class Node;
+
+/// @brief Decides when a model that is being edited has to be compiled again, and takes the snapshots to compile.
+///
+/// @detail A program depends on the nodes that some output depends on, on the number of inputs and outputs, and on
+///         how many connections every node has, since a connection's parameter slot is its index among all of the
+///         connections of the graph. Adding a hidden node that isn't connected to anything, or removing one that
+///         nothing depends on and that has no connections of its own, leaves all of those as they are, and so does
+///         the program. The set of nodes that outputs depend on is kept up to date from the edits reported to this
+///         class, so that each edit can be classified without looking at the rest of the model, and
+///         @ref takeSnapshot only returns a new graph to compile after an edit that changes the program.
+///
+///         The set of nodes is kept conservative: it may hold nodes that no longer matter, for example once a
+///         connection to them has been removed along with a node, but never misses one. It is recomputed exactly from
+///         each snapshot.
+class IncrementalCompiler final
+{
+public:
+  explicit IncrementalCompiler(const Model& model);
+
+  void nodeAdded(const Node* node);
+
+  void nodeRemoved(const Node* node);
+
+  void connectionAdded(const Node* node, const Node* input);
+
+  /// @brief Forces the next snapshot to be taken, for changes that aren't reported through the functions above.
+  void invalidate() { m_dirty = true; }
+
+  /// @brief Indicates whether an edit since the last snapshot has changed the program.
+  auto isDirty() const noexcept -> bool { return m_dirty; }
+
+  /// @brief Takes a snapshot of the model's topology, if an edit since the last snapshot has changed its program.
+  ///
+  /// @detail The snapshot doesn't refer to the model, so it can be compiled on another thread while the model is
+  ///         edited further.
+  ///
+  /// @return The snapshot, or null if the program of the last snapshot is still up to date.
+  auto takeSnapshot() -> std::shared_ptr<const Graph>;
+
+private:
+  /// @brief Adds a node and everything it depends on to @ref m_liveNodes.
+  void markLive(const Node* node);
+
+private:
+  const Model& m_model;
+
+  /// @brief The nodes that an output depends on, including the outputs themselves.
+  std::unordered_set<const Node*> m_liveNodes;
+
+  /// @brief Scratch space for walking the model.
+  std::vector<const Node*> m_pendingNodes;
+
+  bool m_dirty = true;
+};
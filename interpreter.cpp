@@ -0,0 +1,240 @@
+#include "interpreter.h"
+
+#include "regalloc.h"
+
+#include <algorithm>
+
+namespace {
+
+constexpr std::size_t g_blockSize = Interpreter::getBlockSize();
+
+class BlockEvaluator final
+{
+public:
+  BlockEvaluator(float* registers,
+                 const std::size_t* registerOffsets,
+                 const float* parameters,
+                 const float* inputs,
+                 std::size_t inputCount,
+                 std::size_t sampleCount,
+                 Interpreter::Activation activation)
+    : m_registers(registers)
+    , m_registerOffsets(registerOffsets)
+    , m_parameters(parameters)
+    , m_inputs(inputs)
+    , m_inputCount(inputCount)
+    , m_sampleCount(sampleCount)
+    , m_activation(activation)
+  {}
+
+  void operator()(const ZeroExpr&) { std::fill(dst(), dst() + g_blockSize, 0.0f); }
+
+  void operator()(const InputExpr& expr)
+  {
+    float* out = dst();
+
+    const float* in = m_inputs + expr.getInputIndex();
+
+    for (std::size_t i = 0; i < m_sampleCount; i++)
+      out[i] = in[i * m_inputCount];
+
+    std::fill(out + m_sampleCount, out + g_blockSize, 0.0f);
+  }
+
+  void operator()(const WeightExpr& expr) { std::fill(dst(), dst() + g_blockSize, m_parameters[expr.getWeightIndex()]); }
+
+  void operator()(const BiasExpr& expr) { std::fill(dst(), dst() + g_blockSize, m_parameters[expr.getBiasIndex()]); }
+
+  void operator()(const AddExpr& expr)
+  {
+    float* out = dst();
+
+    const float* a = reg(expr.getInputExpr1());
+    const float* b = reg(expr.getInputExpr2());
+
+    for (std::size_t i = 0; i < g_blockSize; i++)
+      out[i] = a[i] + b[i];
+  }
+
+  void operator()(const MultiplyAddExpr& expr)
+  {
+    float* out = dst();
+
+    const float* x = reg(expr.getInputExpr1());
+    const float* b = reg(expr.getInputExpr2());
+    const float* w = reg(expr.getInputExpr3());
+
+    for (std::size_t i = 0; i < g_blockSize; i++)
+      out[i] = (x[i] * w[i]) + b[i];
+  }
+
+  void operator()(const ActivationExpr& expr)
+  {
+    float* out = dst();
+
+    const float* in = reg(expr.getInputExpr());
+
+    std::copy(in, in + g_blockSize, out);
+
+    if (m_activation)
+      m_activation(out, g_blockSize);
+  }
+
+  void operator()(const MatVecExpr& expr)
+  {
+    const auto rowCount = expr.getRowCount();
+    const auto columnCount = expr.getColumnCount();
+
+    const float* weights = m_parameters + expr.getWeightOffset();
+    const float* biases = m_parameters + expr.getBiasOffset();
+
+    for (std::uint32_t row = 0; row < rowCount; row++) {
+
+      float* out = dst() + (row * g_blockSize);
+
+      std::fill(out, out + g_blockSize, 0.0f);
+
+      for (std::uint32_t column = 0; column < columnCount; column++) {
+
+        const float* x = reg(expr.getInputExpr(column));
+
+        const float w = weights[(row * columnCount) + column];
+        const float b = biases[(row * columnCount) + column];
+
+        for (std::size_t i = 0; i < g_blockSize; i++)
+          out[i] += (x[i] * w) + b;
+      }
+    }
+  }
+
+  void operator()(const ElementExpr& expr)
+  {
+    const float* in = reg(expr.getVectorExpr()) + (expr.getElementIndex() * g_blockSize);
+
+    std::copy(in, in + g_blockSize, dst());
+  }
+
+  void operator()(const DotExpr& expr)
+  {
+    /* Even and odd terms go to separate accumulators, so that consecutive terms don't wait on each other. */
+
+    float even[g_blockSize]{};
+    float odd[g_blockSize]{};
+
+    const std::uint32_t termCount = expr.getTermCount();
+
+    const float* weights = m_parameters + expr.getWeightOffset();
+    const float* biases = m_parameters + expr.getBiasOffset();
+
+    std::uint32_t term = 0;
+
+    for (; (term + 1) < termCount; term += 2) {
+
+      const float* x0 = reg(expr.getInputExpr(term));
+      const float* x1 = reg(expr.getInputExpr(term + 1));
+
+      const float w0 = weights[term];
+      const float w1 = weights[term + 1];
+      const float b0 = biases[term];
+      const float b1 = biases[term + 1];
+
+      for (std::size_t i = 0; i < g_blockSize; i++) {
+        even[i] += (x0[i] * w0) + b0;
+        odd[i] += (x1[i] * w1) + b1;
+      }
+    }
+
+    if (term < termCount) {
+
+      const float* x = reg(expr.getInputExpr(term));
+
+      for (std::size_t i = 0; i < g_blockSize; i++)
+        even[i] += (x[i] * weights[term]) + biases[term];
+    }
+
+    float* out = dst();
+
+    for (std::size_t i = 0; i < g_blockSize; i++)
+      out[i] = even[i] + odd[i];
+  }
+
+  void next() { m_dstIndex++; }
+
+private:
+  auto dst() noexcept -> float* { return reg(m_dstIndex); }
+
+  auto reg(std::uint32_t index) noexcept -> float* { return m_registers + (m_registerOffsets[index] * g_blockSize); }
+
+private:
+  float* m_registers;
+
+  const std::size_t* m_registerOffsets;
+
+  const float* m_parameters;
+
+  const float* m_inputs;
+
+  std::size_t m_inputCount;
+
+  std::size_t m_sampleCount;
+
+  Interpreter::Activation m_activation;
+
+  std::uint32_t m_dstIndex = 0;
+};
+
+} // namespace
+
+Interpreter::Interpreter(const Program& program)
+  : m_program(program)
+{
+  const auto allocation = RegisterAllocator(program).allocate();
+
+  m_registerOffsets.assign(allocation.exprSlots.begin(), allocation.exprSlots.end());
+
+  m_registers.resize(allocation.slotCount * g_blockSize);
+}
+
+void
+Interpreter::run(const float* parameters, const float* inputs, std::size_t sampleCount, float* outputs)
+{
+  const std::size_t inputCount = m_program.getInputCount();
+
+  const std::size_t outputCount = m_program.getOutputExprIndices().size();
+
+  for (std::size_t i = 0; i < sampleCount; i += g_blockSize) {
+
+    const auto blockSampleCount = std::min(g_blockSize, sampleCount - i);
+
+    runBlock(parameters, inputs + (i * inputCount), blockSampleCount, outputs + (i * outputCount));
+  }
+}
+
+void
+Interpreter::runBlock(const float* parameters, const float* inputs, std::size_t sampleCount, float* outputs)
+{
+  BlockEvaluator evaluator(m_registers.data(),
+                           m_registerOffsets.data(),
+                           parameters,
+                           inputs,
+                           m_program.getInputCount(),
+                           sampleCount,
+                           m_activation);
+
+  const auto exprCount = static_cast<std::uint32_t>(m_program.size());
+
+  for (std::uint32_t i = 0; i < exprCount; i++) {
+    visit(m_program, i, evaluator);
+    evaluator.next();
+  }
+
+  const auto& outputExprs = m_program.getOutputExprIndices();
+
+  for (std::size_t i = 0; i < outputExprs.size(); i++) {
+
+    const float* values = m_registers.data() + (m_registerOffsets[outputExprs[i]] * g_blockSize);
+
+    for (std::size_t j = 0; j < sampleCount; j++)
+      outputs[(j * outputExprs.size()) + i] = values[j];
+  }
+}
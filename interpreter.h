@@ -0,0 +1,48 @@
+#pragma once
+
+#include "ir.h"
+
+#include <vector>
+
+#include <cstddef>
+
+/// @brief Evaluates a program directly, without generating code for it first.
+///
+/// @detail Samples are evaluated in blocks of @ref getBlockSize. Each instruction is applied to a whole block at once,
+///         which amortizes the cost of decoding it and gives the compiler a fixed-size inner loop to vectorize. The
+///         register file holds one block for each value that is live at the same time, as assigned by the
+///         @ref RegisterAllocator, and is allocated once, when the interpreter is constructed.
+class Interpreter final
+{
+public:
+  /// @brief Applies the activation function, in place, to a number of values.
+  using Activation = void (*)(float* values, std::size_t count);
+
+  explicit Interpreter(const Program& program);
+
+  static constexpr auto getBlockSize() noexcept -> std::size_t { return 16; }
+
+  /// @brief Sets the activation function. By default, no activation function is applied.
+  void setActivation(Activation activation) { m_activation = activation; }
+
+  /// @brief Evaluates a batch of samples.
+  ///
+  /// @param parameters The weights and biases, laid out as described by @ref Program::getParameterLayout.
+  /// @param inputs The input values, one sample after the other.
+  /// @param sampleCount The number of samples in the batch.
+  /// @param outputs The output values, one sample after the other.
+  void run(const float* parameters, const float* inputs, std::size_t sampleCount, float* outputs);
+
+private:
+  void runBlock(const float* parameters, const float* inputs, std::size_t sampleCount, float* outputs);
+
+private:
+  const Program& m_program;
+
+  Activation m_activation = nullptr;
+
+  /// @brief The position of each instruction's result in the register file, in blocks.
+  std::vector<std::size_t> m_registerOffsets;
+
+  std::vector<float> m_registers;
+};
@@ -1,7 +1,83 @@
 #include "ir.h"
 
-Program::Program(ExprVector&& exprs, std::vector<std::uint32_t>&& outputIndices)
-  : m_exprs(std::move(exprs)), m_outputExprs(std::move(outputIndices))
+namespace {
+
+/// @brief Passes each instruction on to an @ref ExprVisitor, as a function object for @ref visit.
+class VisitorAdapter final
+{
+public:
+  explicit VisitorAdapter(ExprVisitor& visitor)
+    : m_visitor(visitor)
+  {}
+
+  template<typename Expr>
+  void operator()(const Expr& expr) const
+  {
+    m_visitor.visit(expr);
+  }
+
+private:
+  ExprVisitor& m_visitor;
+};
+
+} // namespace
+
+void
+Program::reserve(std::size_t exprCount, std::size_t operandCount, std::size_t outputCount)
 {
+  m_opcodes.reserve(exprCount);
+  m_operandOffsets.reserve(exprCount);
+  m_operands.reserve(operandCount);
+  m_outputExprs.reserve(outputCount);
+}
+
+auto
+Program::append(Opcode opcode, const std::uint32_t* operands, std::size_t operandCount) -> std::uint32_t
+{
+  m_opcodes.emplace_back(opcode);
+
+  m_operandOffsets.emplace_back(static_cast<std::uint32_t>(m_operands.size()));
+
+  m_operands.insert(m_operands.end(), operands, operands + operandCount);
 
+  return static_cast<std::uint32_t>(m_opcodes.size() - 1);
+}
+
+auto
+Program::getExprOperandRange(std::uint32_t exprIndex) const noexcept -> OperandRange
+{
+  switch (m_opcodes[exprIndex]) {
+    case Opcode::Zero:
+    case Opcode::Input:
+    case Opcode::Weight:
+    case Opcode::Bias:
+      break;
+    case Opcode::Activation:
+      return OperandRange{ 0, ActivationExpr::operandCount() };
+    case Opcode::Add:
+      return OperandRange{ 0, AddExpr::operandCount() };
+    case Opcode::MultiplyAdd:
+      return OperandRange{ 0, MultiplyAddExpr::operandCount() };
+    case Opcode::MatVec:
+      return OperandRange{ 4, getOperands(exprIndex)[1] };
+    case Opcode::Element:
+      return OperandRange{ 0, 1 };
+    case Opcode::Dot:
+      return OperandRange{ 3, getOperands(exprIndex)[0] };
+  }
+
+  return OperandRange{};
+}
+
+void
+Program::accept(ExprVisitor& visitor) const
+{
+  for (std::uint32_t i = 0; i < m_opcodes.size(); i++)
+    accept(i, visitor);
+}
+
+void
+Program::accept(std::uint32_t exprIndex, ExprVisitor& visitor) const
+{
+  visit(*this, exprIndex, VisitorAdapter(visitor));
 }
@@ -1,9 +1,9 @@
 #pragma once
 
 #include <iosfwd>
-#include <memory>
 #include <vector>
 
+#include <cstddef>
 #include <cstdint>
 
 class ActivationExpr;
@@ -13,6 +13,24 @@ class ZeroExpr;
 class BiasExpr;
 class WeightExpr;
 class InputExpr;
+class MatVecExpr;
+class ElementExpr;
+class DotExpr;
+
+/// @brief Identifies the operation performed by an instruction in a @ref Program.
+enum class Opcode : std::uint8_t
+{
+  Zero,
+  Activation,
+  Add,
+  MultiplyAdd,
+  Input,
+  Weight,
+  Bias,
+  MatVec,
+  Element,
+  Dot
+};
 
 class ExprVisitor
 {
@@ -32,177 +50,411 @@ public:
   virtual void visit(const WeightExpr&) = 0;
 
   virtual void visit(const InputExpr&) = 0;
+
+  virtual void visit(const MatVecExpr&) = 0;
+
+  virtual void visit(const ElementExpr&) = 0;
+
+  virtual void visit(const DotExpr&) = 0;
 };
 
+/// @brief The base of all expression views.
+///
+/// @detail Expressions are not stored as objects. A program keeps its instructions in flat arrays and an expression
+///         is a lightweight view over the operands of one instruction, created on demand while traversing.
 class Expr
 {
 public:
-  virtual ~Expr() = default;
-
-  virtual void accept(ExprVisitor& visitor) const = 0;
-};
+  explicit Expr(const std::uint32_t* operands)
+    : m_operands(operands)
+  {}
 
-using UniqueExprPtr = std::unique_ptr<Expr>;
+protected:
+  auto getOperand(std::size_t index) const noexcept -> std::uint32_t { return m_operands[index]; }
 
-using ExprVector = std::vector<UniqueExprPtr>;
+private:
+  const std::uint32_t* m_operands;
+};
 
-template<typename Derived>
+template<typename Derived, Opcode Op>
 class NullaryExpr : public Expr
 {
 public:
-  virtual ~NullaryExpr() = default;
+  using Expr::Expr;
+
+  static constexpr auto opcode() noexcept -> Opcode { return Op; }
 
-  void accept(ExprVisitor& visitor) const override { visitor.visit(static_cast<const Derived&>(*this)); }
+  static constexpr auto operandCount() noexcept -> std::uint32_t { return 0; }
 };
 
-template<typename Derived>
+template<typename Derived, Opcode Op>
 class UnaryExpr : public Expr
 {
 public:
-  UnaryExpr(std::uint32_t inExpr)
-    : m_inExpr(inExpr)
-  {}
+  using Expr::Expr;
 
-  virtual ~UnaryExpr() = default;
+  static constexpr auto opcode() noexcept -> Opcode { return Op; }
 
-  void accept(ExprVisitor& visitor) const override { visitor.visit(static_cast<const Derived&>(*this)); }
+  static constexpr auto operandCount() noexcept -> std::uint32_t { return 1; }
 
-  auto getInputExpr() const noexcept { return m_inExpr; }
-
-private:
-  std::uint32_t m_inExpr = 0;
+  auto getInputExpr() const noexcept -> std::uint32_t { return getOperand(0); }
 };
 
-template<typename Derived>
+template<typename Derived, Opcode Op>
 class BinaryExpr : public Expr
 {
 public:
-  BinaryExpr(std::uint32_t expr1, std::uint32_t expr2)
-    : m_expr1(expr1)
-    , m_expr2(expr2)
-  {}
+  using Expr::Expr;
 
-  virtual ~BinaryExpr() = default;
+  static constexpr auto opcode() noexcept -> Opcode { return Op; }
 
-  void accept(ExprVisitor& visitor) const override { visitor.visit(static_cast<const Derived&>(*this)); }
+  static constexpr auto operandCount() noexcept -> std::uint32_t { return 2; }
 
-  auto getInputExpr1() const noexcept { return m_expr1; }
-
-  auto getInputExpr2() const noexcept { return m_expr2; }
-
-private:
-  std::uint32_t m_expr1 = 0;
+  auto getInputExpr1() const noexcept -> std::uint32_t { return getOperand(0); }
 
-  std::uint32_t m_expr2 = 0;
+  auto getInputExpr2() const noexcept -> std::uint32_t { return getOperand(1); }
 };
 
-template<typename Derived>
+template<typename Derived, Opcode Op>
 class TernaryExpr : public Expr
 {
 public:
-  TernaryExpr(std::uint32_t expr1, std::uint32_t expr2, std::uint32_t expr3)
-    : m_expr1(expr1)
-    , m_expr2(expr2)
-    , m_expr3(expr3)
-  {}
+  using Expr::Expr;
 
-  virtual ~TernaryExpr() = default;
+  static constexpr auto opcode() noexcept -> Opcode { return Op; }
 
-  void accept(ExprVisitor& visitor) const override { visitor.visit(static_cast<const Derived&>(*this)); }
+  static constexpr auto operandCount() noexcept -> std::uint32_t { return 3; }
 
-  auto getInputExpr1() const noexcept { return m_expr1; }
+  auto getInputExpr1() const noexcept -> std::uint32_t { return getOperand(0); }
 
-  auto getInputExpr2() const noexcept { return m_expr2; }
+  auto getInputExpr2() const noexcept -> std::uint32_t { return getOperand(1); }
 
-  auto getInputExpr3() const noexcept { return m_expr3; }
+  auto getInputExpr3() const noexcept -> std::uint32_t { return getOperand(2); }
+};
 
-private:
-  std::uint32_t m_expr1 = 0;
+/// @brief The base of expressions that carry a single immediate index instead of an input expression.
+template<typename Derived, Opcode Op>
+class IndexExpr : public Expr
+{
+public:
+  using Expr::Expr;
+
+  static constexpr auto opcode() noexcept -> Opcode { return Op; }
 
-  std::uint32_t m_expr2 = 0;
+  static constexpr auto operandCount() noexcept -> std::uint32_t { return 1; }
 
-  std::uint32_t m_expr3 = 0;
+protected:
+  auto getIndex() const noexcept -> std::uint32_t { return getOperand(0); }
 };
 
-class ZeroExpr final : public NullaryExpr<ZeroExpr>
-{};
+class ZeroExpr final : public NullaryExpr<ZeroExpr, Opcode::Zero>
+{
+public:
+  using NullaryExpr<ZeroExpr, Opcode::Zero>::NullaryExpr;
+};
 
-class ActivationExpr final : public UnaryExpr<ActivationExpr>
+class ActivationExpr final : public UnaryExpr<ActivationExpr, Opcode::Activation>
 {
 public:
-  using UnaryExpr<ActivationExpr>::UnaryExpr;
+  using UnaryExpr<ActivationExpr, Opcode::Activation>::UnaryExpr;
 };
 
-class AddExpr final : public BinaryExpr<AddExpr>
+class AddExpr final : public BinaryExpr<AddExpr, Opcode::Add>
 {
 public:
-  using BinaryExpr<AddExpr>::BinaryExpr;
+  using BinaryExpr<AddExpr, Opcode::Add>::BinaryExpr;
 };
 
-class MultiplyAddExpr final : public TernaryExpr<MultiplyAddExpr>
+class MultiplyAddExpr final : public TernaryExpr<MultiplyAddExpr, Opcode::MultiplyAdd>
 {
 public:
-  using TernaryExpr<MultiplyAddExpr>::TernaryExpr;
+  using TernaryExpr<MultiplyAddExpr, Opcode::MultiplyAdd>::TernaryExpr;
 };
 
-class InputExpr final : public Expr
+class InputExpr final : public IndexExpr<InputExpr, Opcode::Input>
 {
 public:
-  InputExpr(std::uint32_t inputIndex)
-    : m_inputIndex(inputIndex)
-  {}
+  using IndexExpr<InputExpr, Opcode::Input>::IndexExpr;
 
-  void accept(ExprVisitor& visitor) const override { visitor.visit(*this); }
+  auto getInputIndex() const noexcept -> std::uint32_t { return getIndex(); }
+};
 
-  auto getInputIndex() const noexcept -> std::uint32_t { return m_inputIndex; }
+class WeightExpr final : public IndexExpr<WeightExpr, Opcode::Weight>
+{
+public:
+  using IndexExpr<WeightExpr, Opcode::Weight>::IndexExpr;
 
-private:
-  std::uint32_t m_inputIndex = 0;
+  auto getWeightIndex() const noexcept -> std::uint32_t { return getIndex(); }
 };
 
-class WeightExpr final : public Expr
+class BiasExpr final : public IndexExpr<BiasExpr, Opcode::Bias>
 {
 public:
-  WeightExpr(std::uint32_t weightIndex)
-    : m_weightIndex(weightIndex)
-  {}
+  using IndexExpr<BiasExpr, Opcode::Bias>::IndexExpr;
+
+  auto getBiasIndex() const noexcept -> std::uint32_t { return getIndex(); }
+};
+
+/// @brief Multiplies a vector of input expressions with a dense matrix of weights.
+///
+/// @detail This is the lowered form of a fully connected layer. Row @e r of the result is the sum, over each column
+///         @e c, of <tt>input[c] * weight[r * columns + c] + bias[r * columns + c]</tt>, where the weights and biases
+///         are read from the parameter buffer starting at the given offsets. The result is a vector with one element
+///         per row, which is read with @ref ElementExpr.
+class MatVecExpr final : public Expr
+{
+public:
+  using Expr::Expr;
 
-  void accept(ExprVisitor& visitor) const override { visitor.visit(*this); }
+  static constexpr auto opcode() noexcept -> Opcode { return Opcode::MatVec; }
 
-  auto getWeightIndex() const noexcept -> std::uint32_t { return m_weightIndex; }
+  static constexpr auto operandCount(std::uint32_t columnCount) noexcept -> std::uint32_t { return 4 + columnCount; }
 
-private:
-  std::uint32_t m_weightIndex = 0;
+  auto getRowCount() const noexcept -> std::uint32_t { return getOperand(0); }
+
+  auto getColumnCount() const noexcept -> std::uint32_t { return getOperand(1); }
+
+  auto getWeightOffset() const noexcept -> std::uint32_t { return getOperand(2); }
+
+  auto getBiasOffset() const noexcept -> std::uint32_t { return getOperand(3); }
+
+  /// @brief Gets the expression of a column of the input vector.
+  auto getInputExpr(std::uint32_t column) const noexcept -> std::uint32_t { return getOperand(4 + column); }
 };
 
-class BiasExpr final : public Expr
+/// @brief Reads one element of the vector produced by a @ref MatVecExpr.
+class ElementExpr final : public Expr
 {
 public:
-  BiasExpr(std::uint32_t biasIndex)
-    : m_biasIndex(biasIndex)
-  {}
+  using Expr::Expr;
 
-  void accept(ExprVisitor& visitor) const override { visitor.visit(*this); }
+  static constexpr auto opcode() noexcept -> Opcode { return Opcode::Element; }
 
-  auto getBiasIndex() const noexcept -> std::uint32_t { return m_biasIndex; }
+  static constexpr auto operandCount() noexcept -> std::uint32_t { return 2; }
 
-private:
-  std::uint32_t m_biasIndex = 0;
+  auto getVectorExpr() const noexcept -> std::uint32_t { return getOperand(0); }
+
+  auto getElementIndex() const noexcept -> std::uint32_t { return getOperand(1); }
 };
 
+/// @brief Sums the products of a number of input expressions with consecutive weights, plus consecutive biases.
+///
+/// @detail This is the reduced form of a node's chain of multiply-adds. The result is the sum, over each term @e t, of
+///         <tt>input[t] * weight[t] + bias[t]</tt>, where the weights and biases are read from the parameter buffer
+///         starting at the given offsets. Unlike the chain, the order of the additions is left to the backend, so it
+///         may use several accumulators.
+class DotExpr final : public Expr
+{
+public:
+  using Expr::Expr;
+
+  static constexpr auto opcode() noexcept -> Opcode { return Opcode::Dot; }
+
+  static constexpr auto operandCount(std::uint32_t termCount) noexcept -> std::uint32_t { return 3 + termCount; }
+
+  auto getTermCount() const noexcept -> std::uint32_t { return getOperand(0); }
+
+  auto getWeightOffset() const noexcept -> std::uint32_t { return getOperand(1); }
+
+  auto getBiasOffset() const noexcept -> std::uint32_t { return getOperand(2); }
+
+  auto getInputExpr(std::uint32_t term) const noexcept -> std::uint32_t { return getOperand(3 + term); }
+};
+
+/// @brief Describes how the parameters of a program are laid out in memory.
+///
+/// @detail Each connection has one weight and one bias. All weights come first, followed by all biases, each in the
+///         order of the connections in the @ref Graph the program was compiled from: connection @e i of node @e n has
+///         the slot <tt>connectionOffsets[n] + i</tt>. The weights (and biases) feeding one node are therefore
+///         contiguous, in the order of that node's connections, and the layout doesn't depend on compiler options.
+struct ParameterLayout final
+{
+  std::uint32_t weightOffset = 0;
+
+  std::uint32_t weightCount = 0;
+
+  std::uint32_t biasOffset = 0;
+
+  std::uint32_t biasCount = 0;
+};
+
+/// @brief A run of operands of an instruction.
+struct OperandRange final
+{
+  std::uint32_t first;
+
+  std::uint32_t count;
+};
+
+/// @brief A compiled model, stored as a structure of arrays.
+///
+/// @detail Each instruction is one entry in the opcode array and a run of entries in the packed operand array. The
+///         result of an instruction is referred to by the index of that instruction. The arrays only ever grow at
+///         the end, so once @ref reserve has been called with the final sizes, building and traversing a program
+///         does not allocate.
 class Program final
 {
 public:
   Program() = default;
 
-  Program(ExprVector&& exprList, std::vector<std::uint32_t>&& outputExprs);
+  /// @brief Preallocates storage for the given number of instructions, operands and outputs.
+  void reserve(std::size_t exprCount, std::size_t operandCount, std::size_t outputCount = 0);
+
+  /// @brief Appends an instruction to the program.
+  ///
+  /// @tparam ExprType The type of expression to append, such as @ref AddExpr.
+  ///
+  /// @return The index of the new instruction, which is how other instructions refer to its result.
+  template<typename ExprType, typename... Operands>
+  auto push(Operands... operands) -> std::uint32_t;
+
+  /// @brief Appends an instruction that takes a variable number of operands, such as @ref MatVecExpr.
+  template<typename ExprType>
+  auto pushVariadic(const std::uint32_t* operands, std::size_t operandCount) -> std::uint32_t;
+
+  /// @brief Appends an instruction given its opcode, for passes that copy instructions without knowing their type.
+  auto append(Opcode opcode, const std::uint32_t* operands, std::size_t operandCount) -> std::uint32_t;
+
+  void addOutput(std::uint32_t exprIndex) { m_outputExprs.emplace_back(exprIndex); }
+
+  /// @brief Sets the number of values the program takes as input. This may be more than the inputs it reads.
+  void setInputCount(std::uint32_t inputCount) { m_inputCount = inputCount; }
+
+  auto getInputCount() const noexcept -> std::uint32_t { return m_inputCount; }
 
-  auto getExprs() const -> const ExprVector& { return m_exprs; }
+  void setParameterLayout(const ParameterLayout& layout) { m_parameterLayout = layout; }
+
+  auto getParameterLayout() const noexcept -> const ParameterLayout& { return m_parameterLayout; }
+
+  /// @brief Gets the number of values in the buffer holding the weights and biases.
+  auto getParameterCount() const noexcept -> std::uint32_t
+  {
+    return m_parameterLayout.weightCount + m_parameterLayout.biasCount;
+  }
+
+  /// @brief Calls the visitor once for each instruction, in program order.
+  ///
+  /// @note This goes through a virtual call per instruction. Passes that run over large programs should use @ref visit
+  ///       instead.
+  void accept(ExprVisitor& visitor) const;
+
+  /// @brief Calls the visitor for the instruction at the given index.
+  void accept(std::uint32_t exprIndex, ExprVisitor& visitor) const;
+
+  auto size() const noexcept -> std::size_t { return m_opcodes.size(); }
+
+  auto empty() const noexcept -> bool { return m_opcodes.empty(); }
+
+  auto getOpcode(std::uint32_t exprIndex) const noexcept -> Opcode { return m_opcodes[exprIndex]; }
+
+  auto getOperands(std::uint32_t exprIndex) const noexcept -> const std::uint32_t*
+  {
+    return m_operands.data() + m_operandOffsets[exprIndex];
+  }
+
+  auto getOperandCount(std::uint32_t exprIndex) const noexcept -> std::uint32_t
+  {
+    const auto end = ((exprIndex + 1) < m_operandOffsets.size()) ? m_operandOffsets[exprIndex + 1]
+                                                                  : static_cast<std::uint32_t>(m_operands.size());
+    return end - m_operandOffsets[exprIndex];
+  }
+
+  /// @brief Gets the operands of an instruction that refer to the results of other instructions.
+  ///
+  /// @detail These are always contiguous. The other operands are immediates, such as indices and sizes.
+  auto getExprOperandRange(std::uint32_t exprIndex) const noexcept -> OperandRange;
+
+  /// @brief Gets the number of values an instruction produces. This is one, except for @ref MatVecExpr.
+  auto getResultSize(std::uint32_t exprIndex) const noexcept -> std::uint32_t
+  {
+    return (m_opcodes[exprIndex] == Opcode::MatVec) ? getOperands(exprIndex)[0] : 1;
+  }
 
   auto getOutputExprIndices() const -> const std::vector<std::uint32_t>& { return m_outputExprs; }
 
 private:
-  ExprVector m_exprs;
+  std::vector<Opcode> m_opcodes;
+
+  std::vector<std::uint32_t> m_operandOffsets;
+
+  std::vector<std::uint32_t> m_operands;
 
   std::vector<std::uint32_t> m_outputExprs;
+
+  std::uint32_t m_inputCount = 0;
+
+  ParameterLayout m_parameterLayout;
 };
+
+template<typename ExprType, typename... Operands>
+auto
+Program::push(Operands... operands) -> std::uint32_t
+{
+  static_assert(sizeof...(Operands) == ExprType::operandCount(), "Wrong number of operands for this expression.");
+
+  const std::uint32_t values[sizeof...(Operands) + 1]{ static_cast<std::uint32_t>(operands)..., 0 };
+
+  return pushVariadic<ExprType>(values, sizeof...(Operands));
+}
+
+template<typename ExprType>
+auto
+Program::pushVariadic(const std::uint32_t* operands, std::size_t operandCount) -> std::uint32_t
+{
+  return append(ExprType::opcode(), operands, operandCount);
+}
+
+/// @brief Calls @p f with a view of the instruction at the given index.
+///
+/// @detail The function object is expected to have a call operator for every expression type, or a generic one.
+///         Dispatch is a switch on the opcode, so the call operators can be inlined into the traversal.
+template<typename F>
+void
+visit(const Program& program, std::uint32_t exprIndex, F&& f)
+{
+  const std::uint32_t* operands = program.getOperands(exprIndex);
+
+  switch (program.getOpcode(exprIndex)) {
+    case Opcode::Zero:
+      f(ZeroExpr(operands));
+      break;
+    case Opcode::Activation:
+      f(ActivationExpr(operands));
+      break;
+    case Opcode::Add:
+      f(AddExpr(operands));
+      break;
+    case Opcode::MultiplyAdd:
+      f(MultiplyAddExpr(operands));
+      break;
+    case Opcode::Input:
+      f(InputExpr(operands));
+      break;
+    case Opcode::Weight:
+      f(WeightExpr(operands));
+      break;
+    case Opcode::Bias:
+      f(BiasExpr(operands));
+      break;
+    case Opcode::MatVec:
+      f(MatVecExpr(operands));
+      break;
+    case Opcode::Element:
+      f(ElementExpr(operands));
+      break;
+    case Opcode::Dot:
+      f(DotExpr(operands));
+      break;
+  }
+}
+
+/// @brief Calls @p f once for each instruction in the program, in program order.
+template<typename F>
+void
+visit(const Program& program, F&& f)
+{
+  const auto exprCount = static_cast<std::uint32_t>(program.size());
+
+  for (std::uint32_t i = 0; i < exprCount; i++)
+    visit(program, i, f);
+}
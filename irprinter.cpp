@@ -0,0 +1,128 @@
+#include "irprinter.h"
+
+#include "ir.h"
+
+#include <QTextStream>
+
+namespace {
+
+class IRPrinter final
+{
+public:
+  IRPrinter(QString* output)
+    : m_irStream(output)
+  {}
+
+  void operator()(const ActivationExpr& activationExpr)
+  {
+    m_irStream << reg(m_dstIndex) << " = activate " << reg(activationExpr.getInputExpr()) << "\n";
+    m_dstIndex++;
+  }
+
+  void operator()(const AddExpr& addExpr)
+  {
+    m_irStream << reg(m_dstIndex) << " = add " << reg(addExpr.getInputExpr1()) << " " << reg(addExpr.getInputExpr2()) << "\n";
+    m_dstIndex++;
+  }
+
+  void operator()(const MultiplyAddExpr& multiplyAddExpr)
+  {
+    m_irStream << reg(m_dstIndex) << " <- madd";
+    m_irStream << ' ';
+    m_irStream << reg(multiplyAddExpr.getInputExpr1());
+    m_irStream << ' ';
+    m_irStream << reg(multiplyAddExpr.getInputExpr2());
+    m_irStream << ' ';
+    m_irStream << reg(multiplyAddExpr.getInputExpr3());
+    m_irStream << '\n';
+    m_dstIndex++;
+  }
+
+  void operator()(const InputExpr& inputExpr)
+  {
+    m_irStream << reg(m_dstIndex) << " = input " << number(inputExpr.getInputIndex()) << "\n";
+    m_dstIndex++;
+  }
+
+  void operator()(const MatVecExpr& matVecExpr)
+  {
+    m_irStream << reg(m_dstIndex) << " = matvec " << number(matVecExpr.getRowCount()) << 'x'
+               << number(matVecExpr.getColumnCount());
+    m_irStream << " weight " << number(matVecExpr.getWeightOffset());
+    m_irStream << " bias " << number(matVecExpr.getBiasOffset());
+
+    for (std::uint32_t i = 0; i < matVecExpr.getColumnCount(); i++)
+      m_irStream << ' ' << reg(matVecExpr.getInputExpr(i));
+
+    m_irStream << '\n';
+    m_dstIndex++;
+  }
+
+  void operator()(const ElementExpr& elementExpr)
+  {
+    m_irStream << reg(m_dstIndex) << " = element " << reg(elementExpr.getVectorExpr()) << ' '
+               << number(elementExpr.getElementIndex()) << "\n";
+    m_dstIndex++;
+  }
+
+  void operator()(const DotExpr& dotExpr)
+  {
+    m_irStream << reg(m_dstIndex) << " = dot " << number(dotExpr.getTermCount());
+    m_irStream << " weight " << number(dotExpr.getWeightOffset());
+    m_irStream << " bias " << number(dotExpr.getBiasOffset());
+
+    for (std::uint32_t i = 0; i < dotExpr.getTermCount(); i++)
+      m_irStream << ' ' << reg(dotExpr.getInputExpr(i));
+
+    m_irStream << '\n';
+    m_dstIndex++;
+  }
+
+  void operator()(const BiasExpr& biasExpr)
+  {
+    m_irStream << reg(m_dstIndex) << " = bias " << number(biasExpr.getBiasIndex()) << "\n";
+    m_dstIndex++;
+  }
+
+  void operator()(const WeightExpr& weightExpr)
+  {
+    m_irStream << reg(m_dstIndex) << " = weight " << number(weightExpr.getWeightIndex()) << "\n";
+    m_dstIndex++;
+  }
+
+  void operator()(const ZeroExpr&)
+  {
+    m_irStream << reg(m_dstIndex) << " = zero\n";
+    m_dstIndex++;
+  }
+
+private:
+  QString number(std::uint32_t value)
+  {
+    return QString::number(value);
+  }
+
+  QString reg(std::uint32_t value)
+  {
+    return QString("%") + QString::number(value);
+  }
+
+private:
+  QTextStream m_irStream;
+
+  std::uint32_t m_dstIndex = 0;
+};
+
+} // namespace
+
+auto
+printProgram(const Program& program) -> QString
+{
+  QString text;
+
+  IRPrinter printer(&text);
+
+  visit(program, printer);
+
+  return text;
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+#include <QString>
+
+class Program;
+
+/// @brief Formats a program as text, with one instruction per line.
+///
+/// @detail Each line names the result of an instruction as "%index", followed by the operation and its operands.
+auto
+printProgram(const Program& program) -> QString;
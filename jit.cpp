@@ -0,0 +1,569 @@
+#include "jit.h"
+
+#include "regalloc.h"
+
+#include <algorithm>
+
+#include <cstring>
+
+#if NNGEN_JIT_SUPPORTED
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+/// @brief The general purpose registers, numbered as in their encoding.
+enum Gpr : std::uint8_t
+{
+  rax = 0,
+  rcx = 1,
+  rdx = 2,
+  rbx = 3,
+  rsp = 4,
+  rbp = 5,
+  rsi = 6,
+  rdi = 7,
+  r8 = 8,
+  r9 = 9,
+  r10 = 10,
+  r11 = 11,
+  r12 = 12,
+  r13 = 13,
+  r14 = 14,
+  r15 = 15
+};
+
+/* The arguments are moved into callee-saved registers, so that they survive calls to the activation function. */
+
+constexpr Gpr g_inputBase = rbx;
+
+constexpr Gpr g_parameterBase = r12;
+
+constexpr Gpr g_outputBase = r13;
+
+constexpr Gpr g_scratchBase = r14;
+
+constexpr Gpr g_activationPointer = r15;
+
+/// @brief The largest index of a value that can be addressed with a 32-bit displacement.
+constexpr std::size_t g_maxValueIndex = 0x1fffffff;
+
+/// @brief Where a value is read from: a base register, a displacement in bytes and, optionally, an index register
+///        that counts values.
+struct Location final
+{
+  Gpr base;
+
+  std::int32_t displacement;
+
+  /// @brief The index register. Since rsp can't be an index, it stands for no index, as in the encoding.
+  Gpr index;
+};
+
+/// @brief The condition codes of the jumps that close loops.
+enum class Condition : std::uint8_t
+{
+  Below = 0x2,
+  NotEqual = 0x5
+};
+
+/// @brief Encodes the few x86-64 instructions that the compiled code is made of.
+///
+/// @detail Memory operands are always encoded with a 32-bit displacement, which keeps the encoding uniform at the cost
+///         of a few bytes per instruction. Only xmm0 to xmm7 are used, so no vector register needs a REX prefix.
+class Assembler final
+{
+public:
+  auto getCode() const noexcept -> const std::vector<std::uint8_t>& { return m_code; }
+
+  auto getPosition() const noexcept -> std::size_t { return m_code.size(); }
+
+  void push(Gpr reg)
+  {
+    if (reg >= 8)
+      byte(0x41);
+    byte(0x50 + (reg & 7));
+  }
+
+  void pop(Gpr reg)
+  {
+    if (reg >= 8)
+      byte(0x41);
+    byte(0x58 + (reg & 7));
+  }
+
+  void ret() { byte(0xc3); }
+
+  /// @brief mov dst, src (64-bit)
+  void mov(Gpr dst, Gpr src)
+  {
+    rex(true, src, dst);
+    byte(0x89);
+    byte(0xc0 | ((src & 7) << 3) | (dst & 7));
+  }
+
+  /// @brief mov dst, imm64
+  void movImmediate64(Gpr dst, std::uint64_t value)
+  {
+    rex(true, 0, dst);
+    byte(0xb8 + (dst & 7));
+    for (int i = 0; i < 8; i++)
+      byte(static_cast<std::uint8_t>(value >> (i * 8)));
+  }
+
+  /// @brief mov dst, imm32 (zero extended)
+  void movImmediate32(Gpr dst, std::uint32_t value)
+  {
+    rex(false, 0, dst);
+    byte(0xb8 + (dst & 7));
+    dword(value);
+  }
+
+  /// @brief lea dst, [base + displacement]
+  void lea(Gpr dst, const Location& src)
+  {
+    rex(true, dst, src);
+    byte(0x8d);
+    memory(dst, src);
+  }
+
+  /// @brief xor dst, src (32-bit, which clears the upper half)
+  void xor32(Gpr dst, Gpr src)
+  {
+    rex(false, src, dst);
+    byte(0x31);
+    byte(0xc0 | ((src & 7) << 3) | (dst & 7));
+  }
+
+  /// @brief add reg, imm32 (64-bit)
+  void add(Gpr reg, std::int32_t value) { arithmeticImmediate(0, reg, value); }
+
+  /// @brief sub reg, imm32 (64-bit)
+  void sub(Gpr reg, std::int32_t value) { arithmeticImmediate(5, reg, value); }
+
+  /// @brief cmp reg, imm32 (64-bit)
+  void cmp(Gpr reg, std::int32_t value) { arithmeticImmediate(7, reg, value); }
+
+  /// @brief Jumps back to an earlier position if the condition holds.
+  void jumpBack(Condition condition, std::size_t target)
+  {
+    byte(0x0f);
+    byte(0x80 | static_cast<std::uint8_t>(condition));
+    dword(static_cast<std::uint32_t>(static_cast<std::int32_t>(target) - static_cast<std::int32_t>(m_code.size() + 4)));
+  }
+
+  /// @brief call reg
+  void call(Gpr reg)
+  {
+    rex(false, 0, reg);
+    byte(0xff);
+    byte(0xd0 | (reg & 7));
+  }
+
+  /// @brief movss xmm, [base + displacement]
+  void movssLoad(std::uint8_t xmm, const Location& src) { sse(0xf3, 0x10, xmm, src); }
+
+  /// @brief movss [base + displacement], xmm
+  void movssStore(const Location& dst, std::uint8_t xmm) { sse(0xf3, 0x11, xmm, dst); }
+
+  /// @brief addss xmm, [base + displacement]
+  void addss(std::uint8_t xmm, const Location& src) { sse(0xf3, 0x58, xmm, src); }
+
+  /// @brief mulss xmm, [base + displacement]
+  void mulss(std::uint8_t xmm, const Location& src) { sse(0xf3, 0x59, xmm, src); }
+
+  /// @brief addss dst, src
+  void addss(std::uint8_t dst, std::uint8_t src) { sseRegisters(0xf3, 0x58, dst, src); }
+
+  /// @brief xorps dst, src
+  void xorps(std::uint8_t dst, std::uint8_t src) { sseRegisters(0, 0x57, dst, src); }
+
+private:
+  void sse(std::uint8_t prefix, std::uint8_t opcode, std::uint8_t xmm, const Location& location)
+  {
+    byte(prefix);
+    rex(false, xmm, location);
+    byte(0x0f);
+    byte(opcode);
+    memory(xmm, location);
+  }
+
+  void sseRegisters(std::uint8_t prefix, std::uint8_t opcode, std::uint8_t dst, std::uint8_t src)
+  {
+    if (prefix != 0)
+      byte(prefix);
+    byte(0x0f);
+    byte(opcode);
+    byte(0xc0 | ((dst & 7) << 3) | (src & 7));
+  }
+
+  /// @brief Emits one of the group of instructions with opcode 0x81, which take a 32-bit immediate.
+  void arithmeticImmediate(std::uint8_t operation, Gpr reg, std::int32_t value)
+  {
+    rex(true, 0, reg);
+    byte(0x81);
+    byte(0xc0 | (operation << 3) | (reg & 7));
+    dword(static_cast<std::uint32_t>(value));
+  }
+
+  /// @brief Emits a REX prefix, if one is needed.
+  void rex(bool wide, std::uint8_t reg, std::uint8_t base, std::uint8_t index = 0)
+  {
+    const std::uint8_t prefix = 0x40 | (wide ? 0x08 : 0) | ((reg >> 3) << 2) | ((index >> 3) << 1) | (base >> 3);
+    if (prefix != 0x40)
+      byte(prefix);
+  }
+
+  void rex(bool wide, std::uint8_t reg, const Location& location) { rex(wide, reg, location.base, location.index); }
+
+  /// @brief Emits the ModRM byte, SIB byte and displacement of a [base + index * 4 + disp32] operand.
+  void memory(std::uint8_t reg, const Location& location)
+  {
+    /* With an index, or with rsp or r12 as the base, the ModRM byte is followed by a SIB byte. An index of rsp means
+     * that there is none. */
+
+    if ((location.index != rsp) || ((location.base & 7) == rsp)) {
+      byte(0x84 | ((reg & 7) << 3));
+      byte(((location.index != rsp) ? 0x80 : 0) | ((location.index & 7) << 3) | (location.base & 7));
+    } else {
+      byte(0x80 | ((reg & 7) << 3) | (location.base & 7));
+    }
+
+    dword(static_cast<std::uint32_t>(location.displacement));
+  }
+
+  void dword(std::uint32_t value)
+  {
+    for (int i = 0; i < 4; i++)
+      byte(static_cast<std::uint8_t>(value >> (i * 8)));
+  }
+
+  void byte(std::uint8_t value) { m_code.emplace_back(value); }
+
+private:
+  std::vector<std::uint8_t> m_code;
+};
+
+auto
+at(Gpr base, std::size_t valueIndex) -> Location
+{
+  return Location{ base, static_cast<std::int32_t>(valueIndex * sizeof(float)), rsp };
+}
+
+auto
+at(Gpr base, Gpr index, std::size_t valueIndex = 0) -> Location
+{
+  return Location{ base, static_cast<std::int32_t>(valueIndex * sizeof(float)), index };
+}
+
+/// @brief Gets the size of the buffer that matrix-vector products gather their inputs into.
+auto
+getGatherSize(const Program& program) -> std::size_t
+{
+  std::size_t gatherSize = 0;
+
+  for (std::uint32_t i = 0; i < program.size(); i++) {
+    if (program.getOpcode(i) == Opcode::MatVec)
+      gatherSize = std::max<std::size_t>(gatherSize, program.getOperands(i)[1]);
+  }
+
+  return gatherSize;
+}
+
+/// @brief Emits the code of each instruction.
+///
+/// @detail Weights, biases, inputs and elements of vectors have no registers of their own. They are read from where
+///         they already are, as the memory operand of the instruction that uses them.
+///
+///         Dot products are unrolled, since each of their terms reads from a different place anyway. Matrix-vector
+///         products gather their inputs into a buffer at the end of the scratch space first, and then loop over it
+///         once per row, so that their code doesn't grow with the number of weights.
+class JitEmitter final
+{
+public:
+  JitEmitter(Assembler& assembler,
+             const Program& program,
+             const RegisterAllocation& allocation,
+             std::size_t gatherOffset,
+             bool hasActivation)
+    : m_assembler(assembler)
+    , m_program(program)
+    , m_allocation(allocation)
+    , m_gatherOffset(gatherOffset)
+    , m_hasActivation(hasActivation)
+  {}
+
+  void operator()(const ZeroExpr&)
+  {
+    m_assembler.xorps(0, 0);
+    m_assembler.movssStore(dst(), 0);
+  }
+
+  void operator()(const InputExpr&) {}
+
+  void operator()(const WeightExpr&) {}
+
+  void operator()(const BiasExpr&) {}
+
+  void operator()(const AddExpr& expr)
+  {
+    m_assembler.movssLoad(0, locate(expr.getInputExpr1()));
+    m_assembler.addss(0, locate(expr.getInputExpr2()));
+    m_assembler.movssStore(dst(), 0);
+  }
+
+  void operator()(const MultiplyAddExpr& expr)
+  {
+    m_assembler.movssLoad(0, locate(expr.getInputExpr1()));
+    m_assembler.mulss(0, locate(expr.getInputExpr3()));
+    m_assembler.addss(0, locate(expr.getInputExpr2()));
+    m_assembler.movssStore(dst(), 0);
+  }
+
+  void operator()(const ActivationExpr& expr)
+  {
+    m_assembler.movssLoad(0, locate(expr.getInputExpr()));
+    m_assembler.movssStore(dst(), 0);
+
+    if (m_hasActivation) {
+      m_assembler.lea(rdi, dst());
+      m_assembler.movImmediate32(rsi, 1);
+      m_assembler.call(g_activationPointer);
+    }
+  }
+
+  void operator()(const MatVecExpr& expr)
+  {
+    const auto rowCount = expr.getRowCount();
+    const auto columnCount = expr.getColumnCount();
+
+    for (std::uint32_t column = 0; column < columnCount; column++) {
+      m_assembler.movssLoad(1, locate(expr.getInputExpr(column)));
+      m_assembler.movssStore(at(g_scratchBase, m_gatherOffset + column), 1);
+    }
+
+    /* rax and r8 walk the rows of weights and biases, r9 the results, r10 counts down the rows and r11 counts up the
+     * columns. */
+
+    const auto rowStride = static_cast<std::int32_t>(columnCount * sizeof(float));
+
+    m_assembler.lea(rax, at(g_parameterBase, expr.getWeightOffset()));
+    m_assembler.lea(r8, at(g_parameterBase, expr.getBiasOffset()));
+    m_assembler.lea(r9, dst());
+    m_assembler.movImmediate32(r10, rowCount);
+
+    const auto rowLoop = m_assembler.getPosition();
+
+    m_assembler.xorps(0, 0);
+    m_assembler.xor32(r11, r11);
+
+    const auto columnLoop = m_assembler.getPosition();
+
+    m_assembler.movssLoad(1, at(g_scratchBase, r11, m_gatherOffset));
+    m_assembler.mulss(1, at(rax, r11));
+    m_assembler.addss(1, at(r8, r11));
+    m_assembler.addss(0, 1);
+    m_assembler.add(r11, 1);
+    m_assembler.cmp(r11, static_cast<std::int32_t>(columnCount));
+    m_assembler.jumpBack(Condition::Below, columnLoop);
+
+    m_assembler.movssStore(at(r9, 0), 0);
+    m_assembler.add(rax, rowStride);
+    m_assembler.add(r8, rowStride);
+    m_assembler.add(r9, sizeof(float));
+    m_assembler.sub(r10, 1);
+    m_assembler.jumpBack(Condition::NotEqual, rowLoop);
+  }
+
+  void operator()(const ElementExpr&) {}
+
+  void operator()(const DotExpr& expr)
+  {
+    /* Even and odd terms go to xmm0 and xmm1, like the two accumulators of the interpreter. */
+
+    const std::uint32_t termCount = expr.getTermCount();
+
+    m_assembler.xorps(0, 0);
+    m_assembler.xorps(1, 1);
+
+    for (std::uint32_t term = 0; term < termCount; term++) {
+      multiplyAdd(2, expr.getInputExpr(term), expr.getWeightOffset() + term, expr.getBiasOffset() + term);
+      m_assembler.addss((term % 2) ? 1 : 0, 2);
+    }
+
+    m_assembler.addss(0, 1);
+    m_assembler.movssStore(dst(), 0);
+  }
+
+  void next() { m_dstIndex++; }
+
+  /// @brief Gets the location of the result of an instruction.
+  auto locate(std::uint32_t exprIndex) const -> Location
+  {
+    const std::uint32_t* operands = m_program.getOperands(exprIndex);
+
+    switch (m_program.getOpcode(exprIndex)) {
+      case Opcode::Input:
+        return at(g_inputBase, operands[0]);
+      case Opcode::Weight:
+      case Opcode::Bias:
+        return at(g_parameterBase, operands[0]);
+      case Opcode::Element:
+        return at(g_scratchBase, m_allocation.exprSlots[operands[0]] + operands[1]);
+      default:
+        break;
+    }
+
+    return at(g_scratchBase, m_allocation.exprSlots[exprIndex]);
+  }
+
+private:
+  /// @brief Computes (x * weight) + bias into an xmm register.
+  void multiplyAdd(std::uint8_t xmm, std::uint32_t inputExpr, std::size_t weightIndex, std::size_t biasIndex)
+  {
+    m_assembler.movssLoad(xmm, locate(inputExpr));
+    m_assembler.mulss(xmm, at(g_parameterBase, weightIndex));
+    m_assembler.addss(xmm, at(g_parameterBase, biasIndex));
+  }
+
+  auto dst() const -> Location { return locate(m_dstIndex); }
+
+private:
+  Assembler& m_assembler;
+
+  const Program& m_program;
+
+  const RegisterAllocation& m_allocation;
+
+  /// @brief Where the inputs of matrix-vector products are gathered, as an index into the scratch space.
+  std::size_t m_gatherOffset;
+
+  bool m_hasActivation;
+
+  std::uint32_t m_dstIndex = 0;
+};
+
+} // namespace
+
+JitProgram::JitProgram(const Program& program, Activation activation)
+  : m_inputCount(program.getInputCount())
+  , m_outputCount(program.getOutputExprIndices().size())
+{
+  /* Leaves and elements are read in place, so only the instructions that compute something get a register. */
+
+  std::vector<std::uint32_t> classes(program.size(), 0);
+
+  for (std::uint32_t i = 0; i < program.size(); i++) {
+    switch (program.getOpcode(i)) {
+      case Opcode::Input:
+      case Opcode::Weight:
+      case Opcode::Bias:
+      case Opcode::Element:
+        classes[i] = RegisterAllocation::noRegister;
+        break;
+      default:
+        break;
+    }
+  }
+
+  RegisterAllocator allocator(program);
+
+  allocator.setRegisterClasses(std::move(classes));
+
+  const auto allocation = allocator.allocate();
+
+  m_scratchSize = allocation.slotCount + getGatherSize(program);
+
+  m_scratch.resize(m_scratchSize);
+
+#if NNGEN_JIT_SUPPORTED
+  if ((m_inputCount > g_maxValueIndex) || (m_outputCount > g_maxValueIndex) ||
+      (program.getParameterCount() > g_maxValueIndex) || (m_scratchSize > g_maxValueIndex))
+    return;
+
+  Assembler assembler;
+
+  /* Five pushes on top of the return address leave the stack 16-byte aligned for calls to the activation function. */
+
+  assembler.push(rbx);
+  assembler.push(r12);
+  assembler.push(r13);
+  assembler.push(r14);
+  assembler.push(r15);
+
+  assembler.mov(g_inputBase, rdi);
+  assembler.mov(g_parameterBase, rsi);
+  assembler.mov(g_outputBase, rdx);
+  assembler.mov(g_scratchBase, rcx);
+
+  if (activation)
+    assembler.movImmediate64(g_activationPointer, reinterpret_cast<std::uintptr_t>(activation));
+
+  JitEmitter emitter(assembler, program, allocation, allocation.slotCount, activation != nullptr);
+
+  for (std::uint32_t i = 0; i < program.size(); i++) {
+    visit(program, i, emitter);
+    emitter.next();
+  }
+
+  const auto& outputExprs = program.getOutputExprIndices();
+
+  for (std::size_t i = 0; i < outputExprs.size(); i++) {
+    assembler.movssLoad(0, emitter.locate(outputExprs[i]));
+    assembler.movssStore(at(g_outputBase, i), 0);
+  }
+
+  assembler.pop(r15);
+  assembler.pop(r14);
+  assembler.pop(r13);
+  assembler.pop(r12);
+  assembler.pop(rbx);
+  assembler.ret();
+
+  const auto& code = assembler.getCode();
+
+  const auto pageSize = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+
+  const std::size_t mappingSize = ((code.size() + pageSize - 1) / pageSize) * pageSize;
+
+  /* The mapping is written while it is writable, then made executable, so it is never both at the same time. */
+
+  void* mapping = mmap(nullptr, mappingSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+  if (mapping == MAP_FAILED)
+    return;
+
+  std::memcpy(mapping, code.data(), code.size());
+
+  if (mprotect(mapping, mappingSize, PROT_READ | PROT_EXEC) != 0) {
+    munmap(mapping, mappingSize);
+    return;
+  }
+
+  m_code = mapping;
+  m_mappingSize = mappingSize;
+  m_codeSize = code.size();
+  m_function = reinterpret_cast<Function>(mapping);
+#else
+  static_cast<void>(activation);
+#endif
+}
+
+JitProgram::~JitProgram()
+{
+#if NNGEN_JIT_SUPPORTED
+  if (m_code)
+    munmap(m_code, m_mappingSize);
+#endif
+}
+
+void
+JitProgram::run(const float* parameters, const float* inputs, std::size_t sampleCount, float* outputs)
+{
+  if (!m_function)
+    return;
+
+  for (std::size_t i = 0; i < sampleCount; i++)
+    m_function(inputs + (i * m_inputCount), parameters, outputs + (i * m_outputCount), m_scratch.data());
+}
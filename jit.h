@@ -0,0 +1,82 @@
+#pragma once
+
+#include "interpreter.h"
+#include "ir.h"
+
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__x86_64__) && (defined(__linux__) || defined(__APPLE__))
+#define NNGEN_JIT_SUPPORTED 1
+#else
+#define NNGEN_JIT_SUPPORTED 0
+#endif
+
+/// @brief Compiles a program to native code in process, without going through a C++ compiler.
+///
+/// @detail The code is written straight from the instructions of the program into an executable buffer, which makes
+///         compiling take about as long as a pass over the program. It evaluates one sample per call, using scalar SSE
+///         arithmetic. Intermediate values are kept in a scratch buffer whose layout comes from the
+///         @ref RegisterAllocator, and every sum is accumulated in the same order as in the @ref Interpreter, so both
+///         produce the same results.
+///
+///         Only x86-64 on Linux and macOS is supported, see @ref isSupported. On other platforms, or if the buffer
+///         can't be mapped, @ref getFunction returns a null pointer.
+class JitProgram final
+{
+public:
+  /// @brief The activation function, as used by the interpreter. The compiled code calls it with one value at a time.
+  using Activation = Interpreter::Activation;
+
+  /// @brief Evaluates one sample.
+  ///
+  /// @param inputs The input values of the sample.
+  /// @param parameters The weights and biases, laid out as described by @ref Program::getParameterLayout.
+  /// @param outputs The output values of the sample.
+  /// @param scratch A buffer of @ref getScratchSize values, for intermediate results.
+  using Function = void (*)(const float* inputs, const float* parameters, float* outputs, float* scratch);
+
+  static constexpr auto isSupported() noexcept -> bool { return NNGEN_JIT_SUPPORTED != 0; }
+
+  /// @brief Compiles a program.
+  ///
+  /// @param activation The activation function to call. When null, no activation function is applied.
+  explicit JitProgram(const Program& program, Activation activation = nullptr);
+
+  JitProgram(const JitProgram&) = delete;
+
+  auto operator=(const JitProgram&) -> JitProgram& = delete;
+
+  ~JitProgram();
+
+  auto getFunction() const noexcept -> Function { return m_function; }
+
+  /// @brief Gets the number of values that the scratch buffer has to hold.
+  auto getScratchSize() const noexcept -> std::size_t { return m_scratchSize; }
+
+  /// @brief Gets the size of the compiled code, in bytes.
+  auto getCodeSize() const noexcept -> std::size_t { return m_codeSize; }
+
+  /// @brief Evaluates a batch of samples, the same way as @ref Interpreter::run.
+  void run(const float* parameters, const float* inputs, std::size_t sampleCount, float* outputs);
+
+private:
+  std::size_t m_inputCount;
+
+  std::size_t m_outputCount;
+
+  std::size_t m_scratchSize = 0;
+
+  std::size_t m_codeSize = 0;
+
+  /// @brief The mapping that holds the code.
+  void* m_code = nullptr;
+
+  std::size_t m_mappingSize = 0;
+
+  Function m_function = nullptr;
+
+  std::vector<float> m_scratch;
+};
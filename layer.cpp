@@ -1 +1,79 @@
 #include "layer.h"
+
+#include "graph.h"
+
+#include <algorithm>
+#include <utility>
+
+Layer::Layer(std::vector<std::uint32_t>&& nodes, const std::uint32_t* inputs, std::uint32_t inputCount)
+  : m_nodes(std::move(nodes))
+  , m_inputs(inputs, inputs + inputCount)
+{}
+
+auto
+findLayers(const GraphView& graph, const std::vector<std::uint32_t>& nodes, std::uint32_t minNodeCount)
+  -> std::vector<Layer>
+{
+  /* Candidates are referred to by their position in the node list, so that sorting them by their connections can
+   * break ties by that position and keep the nodes of each layer in their original order. */
+
+  std::vector<std::uint32_t> candidates;
+
+  candidates.reserve(nodes.size());
+
+  for (std::uint32_t i = 0; i < nodes.size(); i++) {
+    if ((graph.getNodeKind(nodes[i]) != NodeKind::Input) && (graph.getConnectionCount(nodes[i]) > 0))
+      candidates.emplace_back(i);
+  }
+
+  auto sameConnections = [&graph, &nodes](std::uint32_t a, std::uint32_t b) -> bool {
+    const auto aCount = graph.getConnectionCount(nodes[a]);
+    const auto bCount = graph.getConnectionCount(nodes[b]);
+    const auto* aConnections = graph.getConnections(nodes[a]);
+    const auto* bConnections = graph.getConnections(nodes[b]);
+    return (aCount == bCount) && std::equal(aConnections, aConnections + aCount, bConnections);
+  };
+
+  std::sort(candidates.begin(), candidates.end(), [&graph, &nodes](std::uint32_t a, std::uint32_t b) -> bool {
+    const auto aCount = graph.getConnectionCount(nodes[a]);
+    const auto bCount = graph.getConnectionCount(nodes[b]);
+    if (aCount != bCount)
+      return aCount < bCount;
+
+    const auto* aConnections = graph.getConnections(nodes[a]);
+    const auto* bConnections = graph.getConnections(nodes[b]);
+    const auto mismatch = std::mismatch(aConnections, aConnections + aCount, bConnections);
+    if (mismatch.first != (aConnections + aCount))
+      return *mismatch.first < *mismatch.second;
+
+    return a < b;
+  });
+
+  std::vector<Layer> layers;
+
+  for (std::size_t first = 0; first < candidates.size();) {
+
+    auto last = first + 1;
+
+    while ((last < candidates.size()) && sameConnections(candidates[first], candidates[last]))
+      last++;
+
+    if ((last - first) >= minNodeCount) {
+
+      std::vector<std::uint32_t> layerNodes;
+
+      layerNodes.reserve(last - first);
+
+      for (auto i = first; i < last; i++)
+        layerNodes.emplace_back(nodes[candidates[i]]);
+
+      const auto node = layerNodes.front();
+
+      layers.emplace_back(std::move(layerNodes), graph.getConnections(node), graph.getConnectionCount(node));
+    }
+
+    first = last;
+  }
+
+  return layers;
+}
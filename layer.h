@@ -3,17 +3,40 @@
 
 #include "component.h"
 
-#include <QVector>
+#include <vector>
 
-#include <memory>
+#include <cstdint>
 
-class Node;
+class GraphView;
 
+/// @brief A group of nodes that are fully connected to the same inputs.
+///
+/// @detail Every node in a layer takes its input from the same nodes, in the same order, which makes the layer a
+///         dense matrix-vector product. Nodes are referred to by their ID in a @ref Graph.
 class Layer final : public Component
 {
 public:
+  Layer(std::vector<std::uint32_t>&& nodes, const std::uint32_t* inputs, std::uint32_t inputCount);
+
+  auto getNodes() const -> const std::vector<std::uint32_t>& { return m_nodes; }
+
+  auto getInputs() const -> const std::vector<std::uint32_t>& { return m_inputs; }
+
 private:
-  QVector<std::shared_ptr<Node>> m_nodes;
+  std::vector<std::uint32_t> m_nodes;
+
+  std::vector<std::uint32_t> m_inputs;
 };
 
+/// @brief Finds the layers formed by a set of nodes.
+///
+/// @param graph The graph that the nodes belong to.
+/// @param nodes The nodes to consider. Input nodes and nodes without connections are never part of a layer.
+/// @param minNodeCount The smallest number of nodes a group needs in order to be reported as a layer.
+///
+/// @return The layers that were found. The nodes of each layer are in the order they appear in @p nodes.
+auto
+findLayers(const GraphView& graph, const std::vector<std::uint32_t>& nodes, std::uint32_t minNodeCount)
+  -> std::vector<Layer>;
+
 #endif // LAYER_H
@@ -1,5 +1,42 @@
 #include "mainwindow.h"
 
+#include "modelfile.h"
+#include "modelio.h"
+
+#include <QAction>
+#include <QFile>
+#include <QFileDialog>
+#include <QFileInfo>
+#include <QKeySequence>
+#include <QMenu>
+#include <QMenuBar>
+#include <QMessageBox>
+
+#include <algorithm>
+
+constexpr int MainWindow::compileDelay;
+
+constexpr int MainWindow::maxCompileDelay;
+
+namespace {
+
+auto
+haveSameConnections(const Graph& a, const Graph& b) -> bool
+{
+  if ((a.getInputNodeCount() != b.getInputNodeCount()) || (a.getHiddenNodeCount() != b.getHiddenNodeCount()) ||
+      (a.getOutputNodeCount() != b.getOutputNodeCount()) || (a.getConnectionCount() != b.getConnectionCount()))
+    return false;
+
+  const auto* offsets = a.getConnectionOffsets();
+
+  const auto* connections = a.getConnections(0);
+
+  return std::equal(offsets, offsets + a.getNodeCount() + 1, b.getConnectionOffsets()) &&
+         std::equal(connections, connections + a.getConnectionCount(), b.getConnections(0));
+}
+
+} // namespace
+
 MainWindow::MainWindow(QWidget* parent)
   : QMainWindow(parent)
 {
@@ -13,21 +50,154 @@ MainWindow::MainWindow(QWidget* parent)
 
   setCentralWidget(&m_centralWidget);
 
-  connect(&m_model, &Model::modelChanged, [this]() {
+  QMenu* fileMenu = menuBar()->addMenu(tr("&File"));
 
-    m_codeGenerator.generate(m_model);
+  QAction* openAction = fileMenu->addAction(tr("&Open..."));
 
-    m_compilerWidget.compile(m_model);
-  });
+  QAction* saveAction = fileMenu->addAction(tr("Save &As..."));
 
-  connect(&m_compilerWidget, &CompilerWidget::programCompiled, [this]() {
+  openAction->setShortcut(QKeySequence::Open);
+
+  saveAction->setShortcut(QKeySequence::SaveAs);
 
-    //
+  connect(openAction, &QAction::triggered, this, &MainWindow::openModel);
+
+  connect(saveAction, &QAction::triggered, this, &MainWindow::saveModel);
+
+  m_compileTimer.setSingleShot(true);
+
+  m_compileTimer.setInterval(compileDelay);
+
+  connect(&m_model, &Model::modelChanged, this, &MainWindow::scheduleCompile);
+
+  connect(&m_compileTimer, &QTimer::timeout, &m_compilerWidget, &CompilerWidget::compile);
+
+  connect(&m_compilerWidget, &CompilerWidget::programCompiled, [this]() {
+    m_codeGenerator.generate(m_compilerWidget.getProgram());
   });
 
-  connect(&m_codeGenerator, &CodeGenerator::propertiesChanged, [this]() { m_codeGenerator.generate(m_model); });
+  connect(&m_codeGenerator, &CodeGenerator::propertiesChanged, [this]() {
+    m_codeGenerator.generate(m_compilerWidget.getProgram());
+  });
 
-  m_codeGenerator.generate(m_model);
+  m_codeGenerator.generate(m_compilerWidget.getProgram());
 }
 
 MainWindow::~MainWindow() {}
+
+void
+MainWindow::scheduleCompile()
+{
+  if (!m_compileTimer.isActive()) {
+    m_pendingChangeTimer.start();
+    m_compileTimer.start(compileDelay);
+    return;
+  }
+
+  const auto remaining = maxCompileDelay - static_cast<int>(m_pendingChangeTimer.elapsed());
+
+  /* Never push the compile past the deadline of the first pending change. */
+
+  m_compileTimer.start(std::max(std::min(remaining, compileDelay), 0));
+}
+
+void
+MainWindow::openModel()
+{
+  const QString path = QFileDialog::getOpenFileName(
+    this, tr("Open Model"), QString(), tr("Models (*.nnm *.json *.txt);;All Files (*)"));
+
+  if (path.isEmpty())
+    return;
+
+  /* The file is read into a model of its own first, so that the current one is left alone if it can't be read. */
+
+  Model loadedModel;
+
+  QString errorMessage;
+
+  bool loaded = false;
+
+  std::vector<float> parameters;
+
+  const QString suffix = QFileInfo(path).suffix();
+
+  if (suffix == "nnm") {
+    ModelFile modelFile;
+    loaded = modelFile.open(path, &errorMessage) && modelFile.verify(&errorMessage);
+    if (loaded) {
+      modelFile.createModel(loadedModel);
+      parameters.assign(modelFile.getParameters(), modelFile.getParameters() + modelFile.getParameterCount());
+    }
+  } else if (suffix == "json") {
+    loaded = loadJsonModel(path, loadedModel, &errorMessage);
+  } else {
+    loaded = loadTextModel(path, loadedModel, &errorMessage);
+  }
+
+  if (!loaded) {
+    QMessageBox::warning(this, tr("Open Model"), tr("%1 could not be opened: %2").arg(path, errorMessage));
+    return;
+  }
+
+  /* The nodes are only ever connected to each other, so they can be moved over as they are. */
+
+  ModelUpdate update(m_model);
+
+  m_model.clear();
+
+  m_model.appendNodes(Node::NodeVector(loadedModel.getInputNodes()),
+                      Node::NodeVector(loadedModel.getHiddenNodes()),
+                      Node::NodeVector(loadedModel.getOutputNodes()));
+
+  m_parameters = std::move(parameters);
+
+  m_parameterGraph = Graph(m_model);
+}
+
+void
+MainWindow::saveModel()
+{
+  const QString path = QFileDialog::getSaveFileName(
+    this, tr("Save Model"), QString(), tr("Binary Models (*.nnm);;Text Models (*.txt)"));
+
+  if (path.isEmpty())
+    return;
+
+  const bool isText = (QFileInfo(path).suffix() == "txt");
+
+  const bool keepParameters =
+    !m_parameters.empty() && !isText && haveSameConnections(Graph(m_model), m_parameterGraph);
+
+  if (!m_parameters.empty() && !keepParameters) {
+
+    const QString reason = isText ? tr("the text format can't hold them")
+                                  : tr("the connections have changed since the model was opened");
+
+    const QString question = tr("The parameters of the model can't be saved, since %1. Save it without them?");
+
+    const auto answer = QMessageBox::question(this, tr("Save Model"), question.arg(reason));
+
+    if (answer != QMessageBox::Yes)
+      return;
+  }
+
+  QFile file(path);
+
+  QString errorMessage;
+
+  bool saved = file.open(QIODevice::WriteOnly | QIODevice::Truncate);
+
+  if (!saved) {
+    errorMessage = file.errorString();
+  } else if (isText) {
+    saved = writeTextModel(m_model, file, &errorMessage);
+  } else {
+    const float* parameters = keepParameters ? m_parameters.data() : nullptr;
+    const auto parameterCount = keepParameters ? static_cast<std::uint32_t>(m_parameters.size()) : 0;
+    saved = writeModelFile(m_model, file, parameters, parameterCount, &errorMessage);
+  }
+
+  if (!saved)
+    QMessageBox::warning(this, tr("Save Model"), tr("%1 could not be saved: %2").arg(path, errorMessage));
+}
@@ -1,16 +1,21 @@
 #ifndef MAINWINDOW_H
 #define MAINWINDOW_H
 
+#include <QElapsedTimer>
 #include <QMainWindow>
 #include <QPushButton>
 #include <QTabWidget>
 #include <QTextEdit>
+#include <QTimer>
 #include <QVBoxLayout>
 
 #include "cxxcodegenerator.h"
+#include "graph.h"
 #include "model.h"
 #include "modelview.h"
-#include "compiler.h"
+#include "compilerwidget.h"
+
+#include <vector>
 
 class MainWindow : public QMainWindow
 {
@@ -21,6 +26,24 @@ public:
 
   ~MainWindow();
 
+private:
+  /// @brief Schedules a compile after the model has changed.
+  ///
+  /// @detail Each change pushes the compile back by @ref compileDelay, but only until @ref maxCompileDelay has passed
+  ///         since the first change that hasn't been compiled yet, so that a long stream of edits (like dragging a
+  ///         connection around) still gets compiled every so often.
+  void scheduleCompile();
+
+  /// @brief Asks for a model file and replaces the model with its contents.
+  void openModel();
+
+  /// @brief Asks for a file name and writes the model to it, in the binary format or, for *.txt, the text format.
+  ///
+  /// @detail The parameters of the file that was opened are written along with the model, as long as its connections
+  ///         are still the same. Otherwise they no longer fit, and the model is only saved without them once that has
+  ///         been confirmed.
+  void saveModel();
+
 private:
   QWidget m_centralWidget{ this };
 
@@ -34,7 +57,24 @@ private:
 
   CxxCodeGenerator m_codeGenerator{ this };
 
-  CompilerWidget m_compilerWidget{ this };
+  CompilerWidget m_compilerWidget{ m_model, this };
+
+  /// @brief The parameters of the model file that was opened last, if it had any.
+  std::vector<float> m_parameters;
+
+  /// @brief The topology of the model that @ref m_parameters belong to.
+  Graph m_parameterGraph;
+
+  /// @brief Delays compiling until the model has stopped changing for a moment, so that a burst of edits only leads
+  ///        to one compile.
+  QTimer m_compileTimer{ this };
+
+  /// @brief Started when the first change since the last compile arrives.
+  QElapsedTimer m_pendingChangeTimer;
+
+  static constexpr int compileDelay = 100;
+
+  static constexpr int maxCompileDelay = compileDelay * 5;
 };
 
 #endif // MAINWINDOW_H
@@ -2,6 +2,8 @@
 
 #include "node.h"
 
+#include <utility>
+
 Model::Model(QObject* parent)
   : QObject{ parent }
 {}
@@ -28,8 +30,14 @@ auto
 Model::connect(Node* parent, std::shared_ptr<Node> child) -> bool
 {
   if (canConnect(parent, child.get())) {
-    parent->addConnection(std::move(child));
-    emit modelChanged();
+
+    auto* input = child.get();
+
+    if (parent->addConnection(std::move(child))) {
+      emit connectionAdded(parent, input);
+      notifyChanged();
+    }
+
     return true;
   }
 
@@ -39,31 +47,102 @@ Model::connect(Node* parent, std::shared_ptr<Node> child) -> bool
 auto
 Model::createInputNode() -> Node*
 {
-  m_inputNodes.emplace_back(std::make_shared<Node>());
+  m_inputNodes.emplace_back(std::make_shared<Node>(NodeKind::Input));
+
+  auto* node = m_inputNodes.back().get();
 
-  emit modelChanged();
+  emit nodeAdded(node);
 
-  return m_inputNodes.back().get();
+  notifyChanged();
+
+  return node;
 }
 
 auto
 Model::createHiddenNode() -> Node*
 {
-  m_hiddenNodes.emplace_back(std::make_shared<Node>());
+  m_hiddenNodes.emplace_back(std::make_shared<Node>(NodeKind::Hidden));
+
+  auto* node = m_hiddenNodes.back().get();
 
-  emit modelChanged();
+  emit nodeAdded(node);
 
-  return m_hiddenNodes.back().get();
+  notifyChanged();
+
+  return node;
 }
 
 auto
 Model::createOutputNode() -> Node*
 {
-  m_outputNodes.emplace_back(std::make_shared<Node>());
+  m_outputNodes.emplace_back(std::make_shared<Node>(NodeKind::Output));
+
+  auto* node = m_outputNodes.back().get();
+
+  emit nodeAdded(node);
+
+  notifyChanged();
+
+  return node;
+}
+
+namespace {
+
+void
+appendTo(Node::NodeVector& nodes, Node::NodeVector&& newNodes)
+{
+  if (nodes.isEmpty())
+    nodes = std::move(newNodes);
+  else
+    nodes.append(newNodes);
+}
+
+} // namespace
+
+void
+Model::appendNodes(Node::NodeVector&& inputNodes, Node::NodeVector&& hiddenNodes, Node::NodeVector&& outputNodes)
+{
+  /* The signals are only emitted once every node is in place, since the new nodes may be connected to each other. */
+
+  const auto firstInputNode = m_inputNodes.size();
+  const auto firstHiddenNode = m_hiddenNodes.size();
+  const auto firstOutputNode = m_outputNodes.size();
+
+  appendTo(m_inputNodes, std::move(inputNodes));
+  appendTo(m_hiddenNodes, std::move(hiddenNodes));
+  appendTo(m_outputNodes, std::move(outputNodes));
+
+  for (auto i = firstInputNode; i < m_inputNodes.size(); i++)
+    emit nodeAdded(m_inputNodes[i].get());
+
+  for (auto i = firstHiddenNode; i < m_hiddenNodes.size(); i++)
+    emit nodeAdded(m_hiddenNodes[i].get());
 
-  emit modelChanged();
+  for (auto i = firstOutputNode; i < m_outputNodes.size(); i++)
+    emit nodeAdded(m_outputNodes[i].get());
 
-  return m_outputNodes.back().get();
+  notifyChanged();
+}
+
+void
+Model::endUpdate()
+{
+  if (--m_updateDepth > 0)
+    return;
+
+  if (m_changedInUpdate) {
+    m_changedInUpdate = false;
+    emit modelChanged();
+  }
+}
+
+void
+Model::notifyChanged()
+{
+  if (isUpdating())
+    m_changedInUpdate = true;
+  else
+    emit modelChanged();
 }
 
 auto
@@ -93,48 +172,45 @@ Model::getOutputCount() const -> size_type
 void
 Model::destroyNode(Node* node)
 {
-  for (auto it = m_inputNodes.cbegin(); it != m_inputNodes.cend(); it++) {
-    if (it->get() == node) {
-      m_inputNodes.erase(it);
-      emit modelChanged();
-      return;
-    }
-  }
+  /* Only the list of the node's kind has to be searched. */
 
-  for (auto it = m_hiddenNodes.cbegin(); it != m_hiddenNodes.cend(); it++) {
-    if (it->get() == node) {
-      m_hiddenNodes.erase(it);
-      emit modelChanged();
-      return;
-    }
-  }
+  auto& nodes = (node->getKind() == NodeKind::Input)    ? m_inputNodes
+                : (node->getKind() == NodeKind::Hidden) ? m_hiddenNodes
+                                                        : m_outputNodes;
 
-  for (auto it = m_outputNodes.cbegin(); it != m_outputNodes.cend(); it++) {
+  for (auto it = nodes.cbegin(); it != nodes.cend(); it++) {
     if (it->get() == node) {
-      m_outputNodes.erase(it);
-      emit modelChanged();
+      /* The node is kept alive until the signals have been handled. */
+      const auto removedNode = *it;
+      nodes.erase(it);
+      emit nodeRemoved(removedNode.get());
+      notifyChanged();
       return;
     }
   }
 }
 
-auto
-Model::getNodeKind(const Node* node) const -> NodeKind
+void
+Model::clear()
 {
-  for (auto it = m_inputNodes.cbegin(); it != m_inputNodes.cend(); it++) {
-    if (it->get() == node)
-      return NodeKind::Input;
-  }
+  /* The lists are taken out first, so that the model is already empty while the signals are handled, and the nodes
+   * stay alive until they have been. */
 
-  for (auto it = m_hiddenNodes.cbegin(); it != m_hiddenNodes.cend(); it++) {
-    if (it->get() == node)
-      return NodeKind::Hidden;
-  }
+  const Node::NodeVector nodeVectors[3]{ std::move(m_inputNodes), std::move(m_hiddenNodes), std::move(m_outputNodes) };
 
-  for (auto it = m_outputNodes.cbegin(); it != m_outputNodes.cend(); it++) {
-    if (it->get() == node)
-      return NodeKind::Output;
+  m_inputNodes.clear();
+  m_hiddenNodes.clear();
+  m_outputNodes.clear();
+
+  bool changed = false;
+
+  for (const auto& nodes : nodeVectors) {
+    for (const auto& node : nodes) {
+      emit nodeRemoved(node.get());
+      changed = true;
+    }
   }
 
-  return NodeKind::Input;
+  if (changed)
+    notifyChanged();
 }
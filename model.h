@@ -10,13 +10,6 @@
 
 #include "node.h"
 
-enum class NodeKind
-{
-  Input,
-  Hidden,
-  Output
-};
-
 class Model : public QObject
 {
   Q_OBJECT
@@ -35,6 +28,14 @@ public:
 
   auto createOutputNode() -> Node*;
 
+  /// @brief Adds nodes that were built and connected elsewhere, emitting @ref modelChanged once for all of them.
+  ///
+  /// @detail This is how large models are constructed, since creating and connecting the nodes one at a time emits a
+  ///         change for every step. @ref nodeAdded is still emitted for each node, but not @ref connectionAdded, so
+  ///         listeners have to read the connections of the new nodes themselves. The nodes have to be of the kind of
+  ///         the list they are in, and may only be connected to each other and to nodes of this model.
+  void appendNodes(Node::NodeVector&& inputNodes, Node::NodeVector&& hiddenNodes, Node::NodeVector&& outputNodes);
+
   auto getInputNodes() const -> const QVector<std::shared_ptr<Node>>& { return m_inputNodes; }
 
   auto getHiddenNodes() const -> const QVector<std::shared_ptr<Node>>& { return m_hiddenNodes; }
@@ -43,7 +44,23 @@ public:
 
   void destroyNode(Node* node);
 
-  auto getNodeKind(const Node* node) const -> NodeKind;
+  /// @brief Removes every node, emitting @ref nodeRemoved for each of them and @ref modelChanged once.
+  void clear();
+
+  /// @brief Starts a group of edits that is reported as a single change.
+  ///
+  /// @detail Until the matching call to @ref endUpdate, @ref modelChanged is held back, while the more specific
+  ///         signals are still emitted as each edit happens. Groups may be nested, in which case only the outermost one
+  ///         counts. @ref ModelUpdate calls both functions for a scope.
+  void beginUpdate() { m_updateDepth++; }
+
+  /// @brief Ends a group of edits started by @ref beginUpdate, emitting @ref modelChanged once if any of them changed
+  ///        the model.
+  void endUpdate();
+
+  auto isUpdating() const noexcept -> bool { return m_updateDepth > 0; }
+
+  auto getNodeKind(const Node* node) const -> NodeKind { return node->getKind(); }
 
   auto getConnectionCount() const -> size_type;
 
@@ -55,14 +72,53 @@ public:
   auto countNodeProperty(Counter counter) const -> size_type;
 
 signals:
+  /// @brief Emitted after any change to the nodes or connections, following the more specific signals below. Within a
+  ///        group of edits, it is only emitted once, at the end.
   void modelChanged();
 
+  void nodeAdded(Node* node);
+
+  /// @brief Emitted after a node has been taken out of the model. The node is still alive while this is handled.
+  void nodeRemoved(Node* node);
+
+  /// @brief Emitted after a node has been connected to a node that it now takes its input from.
+  void connectionAdded(Node* node, Node* input);
+
+private:
+  /// @brief Emits @ref modelChanged, or remembers to do so at the end of the current group of edits.
+  void notifyChanged();
+
 private:
   QVector<std::shared_ptr<Node>> m_inputNodes;
 
   QVector<std::shared_ptr<Node>> m_outputNodes;
 
   QVector<std::shared_ptr<Node>> m_hiddenNodes;
+
+  int m_updateDepth = 0;
+
+  /// @brief Whether an edit has happened since the outermost @ref beginUpdate.
+  bool m_changedInUpdate = false;
+};
+
+/// @brief Groups the edits made to a model during its lifetime, so that they are reported as a single change.
+class ModelUpdate final
+{
+public:
+  explicit ModelUpdate(Model& model)
+    : m_model(model)
+  {
+    m_model.beginUpdate();
+  }
+
+  ModelUpdate(const ModelUpdate&) = delete;
+
+  auto operator=(const ModelUpdate&) -> ModelUpdate& = delete;
+
+  ~ModelUpdate() { m_model.endUpdate(); }
+
+private:
+  Model& m_model;
 };
 
 template<typename Counter>
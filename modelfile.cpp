@@ -0,0 +1,356 @@
+#include "modelfile.h"
+
+#include "model.h"
+#include "node.h"
+
+#include <QIODevice>
+#include <QSysInfo>
+
+#include <vector>
+
+#include <cstring>
+
+namespace {
+
+constexpr char g_magic[8]{ 'N', 'N', 'G', 'E', 'N', 'M', 'D', 'L' };
+
+/// @brief The start of every model file. The sections follow it in the order they are listed here.
+struct Header final
+{
+  char magic[8];
+
+  std::uint32_t version;
+
+  std::uint32_t inputNodeCount;
+
+  std::uint32_t hiddenNodeCount;
+
+  std::uint32_t outputNodeCount;
+
+  std::uint32_t connectionCount;
+
+  std::uint32_t parameterCount;
+
+  std::uint64_t connectionOffsetsOffset;
+
+  std::uint64_t connectionsOffset;
+
+  std::uint64_t positionsOffset;
+
+  std::uint64_t parametersOffset;
+
+  std::uint64_t fileSize;
+};
+
+static_assert(sizeof(Header) == 72, "the header must not contain padding");
+
+constexpr auto
+alignUp(std::uint64_t offset, std::uint64_t alignment) -> std::uint64_t
+{
+  return (offset + alignment - 1) / alignment * alignment;
+}
+
+/// @brief Computes where each section goes. The counts are 32 bits wide, so none of this can overflow.
+void
+layOut(Header& header)
+{
+  const std::uint64_t nodeCount =
+    std::uint64_t(header.inputNodeCount) + header.hiddenNodeCount + header.outputNodeCount;
+
+  header.connectionOffsetsOffset = alignUp(sizeof(Header), sizeof(std::uint32_t));
+  header.connectionsOffset = header.connectionOffsetsOffset + ((nodeCount + 1) * sizeof(std::uint32_t));
+  header.positionsOffset = alignUp(
+    header.connectionsOffset + (std::uint64_t(header.connectionCount) * sizeof(std::uint32_t)), 2 * sizeof(float));
+  header.parametersOffset =
+    alignUp(header.positionsOffset + (nodeCount * 2 * sizeof(float)), ModelFile::parameterAlignment);
+  header.fileSize = header.parametersOffset + (std::uint64_t(header.parameterCount) * sizeof(float));
+}
+
+auto
+fail(QString* errorMessage, const QString& message) -> bool
+{
+  if (errorMessage)
+    *errorMessage = message;
+
+  return false;
+}
+
+/// @brief Writes the sections of a file one after the other, padding each up to its offset.
+class Writer final
+{
+public:
+  explicit Writer(QIODevice& device)
+    : m_device(device)
+  {}
+
+  template<typename T>
+  auto write(std::uint64_t offset, const T* data, std::size_t count) -> bool
+  {
+    static const char zeros[ModelFile::parameterAlignment]{};
+
+    if (offset < m_size)
+      return false;
+
+    const auto paddingSize = static_cast<qint64>(offset - m_size);
+
+    if (m_device.write(zeros, paddingSize) != paddingSize)
+      return false;
+
+    const auto size = static_cast<qint64>(count * sizeof(T));
+
+    if ((size > 0) && (m_device.write(reinterpret_cast<const char*>(data), size) != size))
+      return false;
+
+    m_size = offset + static_cast<std::uint64_t>(size);
+
+    return true;
+  }
+
+private:
+  QIODevice& m_device;
+
+  std::uint64_t m_size = 0;
+};
+
+} // namespace
+
+auto
+ModelFile::open(const QString& path, QString* errorMessage) -> bool
+{
+  close();
+
+  if (QSysInfo::ByteOrder != QSysInfo::LittleEndian)
+    return fail(errorMessage, "model files can only be read on little endian machines");
+
+  m_file.setFileName(path);
+
+  if (!m_file.open(QIODevice::ReadOnly))
+    return fail(errorMessage, m_file.errorString());
+
+  const auto fileSize = static_cast<std::uint64_t>(m_file.size());
+
+  Header header;
+
+  if (fileSize < sizeof(header)) {
+    close();
+    return fail(errorMessage, "not a model file");
+  }
+
+  const uchar* data = m_file.map(0, m_file.size());
+
+  if (!data) {
+    const QString message = m_file.errorString();
+    close();
+    return fail(errorMessage, message);
+  }
+
+  std::memcpy(&header, data, sizeof(header));
+
+  if (std::memcmp(header.magic, g_magic, sizeof(g_magic)) != 0) {
+    close();
+    return fail(errorMessage, "not a model file");
+  }
+
+  if (header.version != version) {
+    close();
+    return fail(errorMessage, QString("unsupported model file version %1").arg(header.version));
+  }
+
+  /* The offsets are recomputed rather than trusted, which also checks that they are aligned and in bounds. */
+
+  Header expected = header;
+
+  layOut(expected);
+
+  if ((std::memcmp(&header, &expected, sizeof(header)) != 0) || (header.fileSize != fileSize)) {
+    close();
+    return fail(errorMessage, "the model file is truncated or corrupt");
+  }
+
+  const auto* connectionOffsets = reinterpret_cast<const std::uint32_t*>(data + header.connectionOffsetsOffset);
+
+  const std::uint64_t nodeCount =
+    std::uint64_t(header.inputNodeCount) + header.hiddenNodeCount + header.outputNodeCount;
+
+  if ((nodeCount > 0xffffffffu) || (connectionOffsets[0] != 0) ||
+      (connectionOffsets[nodeCount] != header.connectionCount)) {
+    close();
+    return fail(errorMessage, "the model file is truncated or corrupt");
+  }
+
+  m_data = data;
+  m_inputNodeCount = header.inputNodeCount;
+  m_hiddenNodeCount = header.hiddenNodeCount;
+  m_outputNodeCount = header.outputNodeCount;
+  m_parameterCount = header.parameterCount;
+  m_connectionOffsets = connectionOffsets;
+  m_connections = reinterpret_cast<const std::uint32_t*>(data + header.connectionsOffset);
+  m_positions = reinterpret_cast<const float*>(data + header.positionsOffset);
+  m_parameters = (header.parameterCount > 0) ? reinterpret_cast<const float*>(data + header.parametersOffset) : nullptr;
+
+  return true;
+}
+
+void
+ModelFile::close()
+{
+  /* Closing the file also removes its mappings. */
+
+  m_file.close();
+
+  m_data = nullptr;
+  m_inputNodeCount = 0;
+  m_hiddenNodeCount = 0;
+  m_outputNodeCount = 0;
+  m_parameterCount = 0;
+  m_connectionOffsets = nullptr;
+  m_connections = nullptr;
+  m_positions = nullptr;
+  m_parameters = nullptr;
+}
+
+auto
+ModelFile::verify(QString* errorMessage) const -> bool
+{
+  if (!isOpen())
+    return fail(errorMessage, "no model file is open");
+
+  const GraphView graph = getGraph();
+
+  const auto nodeCount = graph.getNodeCount();
+
+  /* A node can only be connected to another one once, as in a model, or the two would disagree on the number of
+   * connections and so on the parameter slots. The last node found to connect to each node is recorded to spot a
+   * second connection from the same node. */
+
+  std::vector<std::uint32_t> lastUsers(nodeCount, nodeCount);
+
+  for (std::uint32_t node = 0; node < nodeCount; node++) {
+
+    if (m_connectionOffsets[node] > m_connectionOffsets[node + 1])
+      return fail(errorMessage, QString("node %1 has a negative number of connections").arg(node));
+
+    if ((graph.getNodeKind(node) == NodeKind::Input) && (graph.getConnectionCount(node) > 0))
+      return fail(errorMessage, QString("input node %1 has connections").arg(node));
+
+    for (std::uint32_t i = 0; i < graph.getConnectionCount(node); i++) {
+
+      const auto from = graph.getConnections(node)[i];
+
+      if ((from >= nodeCount) || (graph.getNodeKind(from) == NodeKind::Output) || (from == node))
+        return fail(errorMessage, QString("node %1 has an invalid connection to %2").arg(node).arg(from));
+
+      if (lastUsers[from] == node)
+        return fail(errorMessage, QString("node %1 is connected to %2 more than once").arg(node).arg(from));
+
+      lastUsers[from] = node;
+    }
+  }
+
+  const std::uint64_t connectionCount = graph.getConnectionCount();
+
+  if ((m_parameterCount != 0) && (m_parameterCount != (connectionCount * 2))) {
+    const auto message = QString("%1 parameters don't fit %2 connections").arg(m_parameterCount).arg(connectionCount);
+    return fail(errorMessage, message);
+  }
+
+  /* The compiler only asserts that there are no cycles, so they have to be refused here. */
+
+  if (hasCycle(graph))
+    return fail(errorMessage, "the connections form a cycle");
+
+  return true;
+}
+
+auto
+ModelFile::getGraph() const noexcept -> GraphView
+{
+  return GraphView(m_inputNodeCount, m_hiddenNodeCount, m_outputNodeCount, m_connectionOffsets, m_connections);
+}
+
+void
+ModelFile::createModel(Model& model) const
+{
+  const GraphView graph = getGraph();
+
+  std::vector<std::shared_ptr<Node>> nodes;
+
+  nodes.reserve(graph.getNodeCount());
+
+  for (std::uint32_t node = 0; node < graph.getNodeCount(); node++) {
+    nodes.emplace_back(std::make_shared<Node>(graph.getNodeKind(node)));
+    nodes.back()->setPosition(QVector2D(m_positions[node * 2], m_positions[(node * 2) + 1]));
+  }
+
+  for (std::uint32_t node = 0; node < graph.getNodeCount(); node++) {
+    for (std::uint32_t i = 0; i < graph.getConnectionCount(node); i++)
+      nodes[node]->addConnection(nodes[graph.getConnections(node)[i]]);
+  }
+
+  const auto firstHiddenNode = nodes.begin() + graph.getInputNodeCount();
+
+  const auto firstOutputNode = nodes.begin() + graph.getFirstOutputNode();
+
+  model.appendNodes(Node::NodeVector(nodes.begin(), firstHiddenNode),
+                    Node::NodeVector(firstHiddenNode, firstOutputNode),
+                    Node::NodeVector(firstOutputNode, nodes.end()));
+}
+
+auto
+writeModelFile(const Model& model,
+               QIODevice& device,
+               const float* parameters,
+               std::uint32_t parameterCount,
+               QString* errorMessage) -> bool
+{
+  if (QSysInfo::ByteOrder != QSysInfo::LittleEndian)
+    return fail(errorMessage, "model files can only be written on little endian machines");
+
+  const Graph graph(model);
+
+  /* There is a weight and a bias per connection, as described by the parameter layout. */
+
+  const std::uint64_t connectionCount = graph.getConnectionCount();
+
+  if (parameters && (parameterCount != (connectionCount * 2))) {
+    const auto message = QString("%1 parameters don't fit %2 connections").arg(parameterCount).arg(connectionCount);
+    return fail(errorMessage, message);
+  }
+
+  Header header{};
+
+  std::memcpy(header.magic, g_magic, sizeof(g_magic));
+
+  header.version = ModelFile::version;
+  header.inputNodeCount = graph.getInputNodeCount();
+  header.hiddenNodeCount = graph.getHiddenNodeCount();
+  header.outputNodeCount = graph.getOutputNodeCount();
+  header.connectionCount = graph.getConnectionCount();
+  header.parameterCount = parameters ? parameterCount : 0;
+
+  layOut(header);
+
+  std::vector<float> positions;
+
+  positions.reserve(std::size_t(graph.getNodeCount()) * 2);
+
+  for (const auto* nodes : { &model.getInputNodes(), &model.getHiddenNodes(), &model.getOutputNodes() }) {
+    for (const auto& node : *nodes) {
+      positions.emplace_back(node->getPosition().x());
+      positions.emplace_back(node->getPosition().y());
+    }
+  }
+
+  Writer writer(device);
+
+  const std::size_t connectionOffsetCount = std::size_t(graph.getNodeCount()) + 1;
+
+  const bool written =
+    writer.write(0, &header, 1) &&
+    writer.write(header.connectionOffsetsOffset, graph.getConnectionOffsets(), connectionOffsetCount) &&
+    writer.write(header.connectionsOffset, graph.getConnections(0), graph.getConnectionCount()) &&
+    writer.write(header.positionsOffset, positions.data(), positions.size()) &&
+    writer.write(header.parametersOffset, parameters, header.parameterCount);
+
+  return written || fail(errorMessage, device.errorString());
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "graph.h"
+
+#include <QFile>
+#include <QString>
+
+#include <cstddef>
+#include <cstdint>
+
+class Model;
+class QIODevice;
+
+/// @brief A model file in the binary format, mapped into memory.
+///
+/// @detail The format is a fixed size header followed by flat arrays, each starting at an offset recorded in the
+///         header:
+///
+///         - the connection offsets of the graph, one per node plus one, as in @ref Graph
+///         - the connections of the graph, as node IDs
+///         - the position of each node, as pairs of floats
+///         - the parameters, as floats, starting on a 64 byte boundary so that they can be loaded with aligned vector
+///           instructions
+///
+///         Numbers are stored little endian. The parameters are laid out as described by @ref ParameterLayout, that is
+///         a weight per connection of the graph, in the order of the connections, followed by a bias per connection.
+///         They may be left out.
+///
+///         Opening a file maps it and checks the header, which takes the same time no matter how large the model is.
+///         Nothing is copied: @ref getGraph points straight into the mapping, so the file can be compiled without
+///         building a @ref Model first. The structure of the arrays is only checked by @ref verify.
+class ModelFile final
+{
+public:
+  /// @brief The version written by @ref writeModelFile. Files of other versions are refused.
+  static constexpr std::uint32_t version = 1;
+
+  /// @brief The alignment of the parameters, relative to the start of the file.
+  static constexpr std::size_t parameterAlignment = 64;
+
+  ModelFile() = default;
+
+  ModelFile(const ModelFile&) = delete;
+
+  auto operator=(const ModelFile&) -> ModelFile& = delete;
+
+  /// @brief Maps a file, closing the one that was open before.
+  ///
+  /// @param errorMessage If not null, receives a description of the problem on failure.
+  auto open(const QString& path, QString* errorMessage = nullptr) -> bool;
+
+  void close();
+
+  auto isOpen() const noexcept -> bool { return m_data != nullptr; }
+
+  /// @brief Checks that every connection refers to an existing node, respects the kinds of the nodes and appears only
+  ///        once, and that the connections don't form a cycle, which takes time in proportion to the size of the graph.
+  ///        A file has to pass this before its graph is compiled.
+  auto verify(QString* errorMessage = nullptr) const -> bool;
+
+  /// @brief Gets the graph stored in the file. It is only valid while the file is open.
+  auto getGraph() const noexcept -> GraphView;
+
+  /// @brief Gets the positions of the nodes, as an x and a y coordinate per node ID.
+  auto getPositions() const noexcept -> const float* { return m_positions; }
+
+  auto getParameterCount() const noexcept -> std::uint32_t { return m_parameterCount; }
+
+  /// @brief Gets the parameters, or null if the file has none.
+  auto getParameters() const noexcept -> const float* { return m_parameters; }
+
+  /// @brief Adds the nodes and connections of the file to a model, all at once through @ref Model::appendNodes.
+  void createModel(Model& model) const;
+
+private:
+  QFile m_file;
+
+  const uchar* m_data = nullptr;
+
+  std::uint32_t m_inputNodeCount = 0;
+
+  std::uint32_t m_hiddenNodeCount = 0;
+
+  std::uint32_t m_outputNodeCount = 0;
+
+  std::uint32_t m_parameterCount = 0;
+
+  const std::uint32_t* m_connectionOffsets = nullptr;
+
+  const std::uint32_t* m_connections = nullptr;
+
+  const float* m_positions = nullptr;
+
+  const float* m_parameters = nullptr;
+};
+
+/// @brief Writes a model in the format read by @ref ModelFile.
+///
+/// @param parameters The parameters to store, or null to store none. There have to be two per connection.
+/// @param errorMessage If not null, receives a description of the problem on failure.
+auto
+writeModelFile(const Model& model,
+               QIODevice& device,
+               const float* parameters = nullptr,
+               std::uint32_t parameterCount = 0,
+               QString* errorMessage = nullptr) -> bool;
@@ -0,0 +1,723 @@
+#include "modelio.h"
+
+#include "graph.h"
+#include "model.h"
+#include "node.h"
+
+#include <QByteArray>
+#include <QFile>
+#include <QHash>
+#include <QIODevice>
+#include <QStringList>
+#include <QTextStream>
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace {
+
+auto
+fail(QString* errorMessage, int lineNumber, const QString& message) -> bool
+{
+  if (errorMessage)
+    *errorMessage = QString("line %1: %2").arg(lineNumber).arg(message);
+
+  return false;
+}
+
+/// @brief Collects the nodes of a model as they are read, and adds them to the model all at once at the end.
+///
+/// @detail Nodes are looked up by name when connecting them, which is the only state kept besides the nodes
+///         themselves, so the memory used does not depend on how the input is laid out.
+class ModelBuilder final
+{
+public:
+  /// @return The new node, or null if the name is already taken.
+  auto addNode(const QString& name, NodeKind kind) -> Node*
+  {
+    if (m_nodes.contains(name))
+      return nullptr;
+
+    auto node = std::make_shared<Node>(kind);
+
+    auto* result = node.get();
+
+    switch (kind) {
+      case NodeKind::Input:
+        m_inputNodes.emplace_back(node);
+        break;
+      case NodeKind::Hidden:
+        m_hiddenNodes.emplace_back(node);
+        break;
+      case NodeKind::Output:
+        m_outputNodes.emplace_back(node);
+        break;
+    }
+
+    m_nodes.insert(name, std::move(node));
+
+    return result;
+  }
+
+  /// @brief Feeds the value of one node into another.
+  ///
+  /// @param error Receives a description of the problem, if there is one.
+  auto connect(const QString& from, const QString& to, QString& error) -> bool
+  {
+    const auto fromIt = m_nodes.find(from);
+    const auto toIt = m_nodes.find(to);
+
+    if (fromIt == m_nodes.end()) {
+      error = QString("unknown node '%1'").arg(from);
+      return false;
+    }
+
+    if (toIt == m_nodes.end()) {
+      error = QString("unknown node '%1'").arg(to);
+      return false;
+    }
+
+    const auto& fromNode = *fromIt;
+    const auto& toNode = *toIt;
+
+    if ((fromNode->getKind() == NodeKind::Output) || (toNode->getKind() == NodeKind::Input) || (fromNode == toNode)) {
+      error = QString("'%1' can't feed '%2'").arg(from).arg(to);
+      return false;
+    }
+
+    toNode->addConnection(fromNode);
+
+    return true;
+  }
+
+  /// @brief Moves the nodes into the model, unless their connections form a cycle.
+  auto finish(Model& model) -> bool
+  {
+    if (hasCycle(Graph(m_inputNodes, m_hiddenNodes, m_outputNodes)))
+      return false;
+
+    m_nodes.clear();
+
+    model.appendNodes(std::move(m_inputNodes), std::move(m_hiddenNodes), std::move(m_outputNodes));
+
+    return true;
+  }
+
+private:
+  QHash<QString, std::shared_ptr<Node>> m_nodes;
+
+  Node::NodeVector m_inputNodes;
+
+  Node::NodeVector m_hiddenNodes;
+
+  Node::NodeVector m_outputNodes;
+};
+
+/// @brief Reads JSON from a device a block at a time, for inputs too large to hold in memory.
+///
+/// @detail This only provides the pieces of a recursive descent parser. The structure of the document is up to the
+///         caller, which is what allows each element to be handled as soon as it has been read.
+class JsonReader final
+{
+public:
+  explicit JsonReader(QIODevice& device)
+    : m_device(device)
+    , m_buffer(g_blockSize)
+  {}
+
+  auto getLineNumber() const noexcept -> int { return m_lineNumber; }
+
+  /// @brief Skips whitespace and gets the next character without consuming it, or -1 at the end of the input.
+  auto peek() -> int
+  {
+    for (;;) {
+
+      const auto c = peekChar();
+
+      if ((c != ' ') && (c != '\t') && (c != '\n') && (c != '\r'))
+        return c;
+
+      takeChar();
+    }
+  }
+
+  /// @brief Consumes the next character if it is the given one.
+  auto consume(char expected) -> bool
+  {
+    if (peek() != expected)
+      return false;
+
+    takeChar();
+
+    return true;
+  }
+
+  auto readString(QString& value) -> bool
+  {
+    if (!consume('"'))
+      return false;
+
+    QByteArray bytes;
+
+    for (;;) {
+
+      auto c = takeChar();
+
+      if ((c < 0) || (c == '\n'))
+        return false;
+
+      if (c == '"')
+        break;
+
+      if (c != '\\') {
+        bytes.append(static_cast<char>(c));
+        continue;
+      }
+
+      c = takeChar();
+
+      switch (c) {
+        case '"':
+        case '\\':
+        case '/':
+          bytes.append(static_cast<char>(c));
+          break;
+        case 'b':
+          bytes.append('\b');
+          break;
+        case 'f':
+          bytes.append('\f');
+          break;
+        case 'n':
+          bytes.append('\n');
+          break;
+        case 'r':
+          bytes.append('\r');
+          break;
+        case 't':
+          bytes.append('\t');
+          break;
+        case 'u': {
+          std::uint32_t codePoint = 0;
+          if (!readHex(codePoint))
+            return false;
+          /* A character outside of the basic plane is written as a surrogate pair. */
+          if ((codePoint >= 0xd800) && (codePoint < 0xdc00)) {
+            std::uint32_t low = 0;
+            if ((takeChar() != '\\') || (takeChar() != 'u') || !readHex(low) || (low < 0xdc00) || (low >= 0xe000))
+              return false;
+            codePoint = 0x10000 + ((codePoint - 0xd800) << 10) + (low - 0xdc00);
+          }
+          appendUtf8(bytes, codePoint);
+          break;
+        }
+        default:
+          return false;
+      }
+    }
+
+    value = QString::fromUtf8(bytes);
+
+    return true;
+  }
+
+  auto readNumber(double& value) -> bool
+  {
+    QByteArray text;
+
+    for (auto c = peek(); isNumberChar(c); c = peekChar())
+      text.append(static_cast<char>(takeChar()));
+
+    bool valid = false;
+
+    value = text.toDouble(&valid);
+
+    return valid;
+  }
+
+  /// @brief Skips over a value of any type, including nested arrays and objects.
+  auto skipValue() -> bool
+  {
+    std::size_t depth = 0;
+
+    do {
+
+      const auto c = peek();
+
+      if (c == '"') {
+
+        QString ignored;
+
+        if (!readString(ignored))
+          return false;
+
+      } else if ((c == '{') || (c == '[')) {
+
+        takeChar();
+        depth++;
+
+      } else if ((c == '}') || (c == ']')) {
+
+        if (depth == 0)
+          return false;
+
+        takeChar();
+        depth--;
+
+      } else if ((depth > 0) && ((c == ',') || (c == ':'))) {
+
+        takeChar();
+
+      } else if (isNumberChar(c) || ((c >= 'a') && (c <= 'z'))) {
+
+        while (isNumberChar(peekChar()) || ((peekChar() >= 'a') && (peekChar() <= 'z')))
+          takeChar();
+
+      } else {
+        return false;
+      }
+
+    } while (depth > 0);
+
+    return true;
+  }
+
+private:
+  static constexpr std::size_t g_blockSize = 64 * 1024;
+
+  static auto isNumberChar(int c) -> bool
+  {
+    return ((c >= '0') && (c <= '9')) || (c == '-') || (c == '+') || (c == '.') || (c == 'e') || (c == 'E');
+  }
+
+  static void appendUtf8(QByteArray& bytes, std::uint32_t codePoint)
+  {
+    if (codePoint < 0x80) {
+      bytes.append(static_cast<char>(codePoint));
+    } else if (codePoint < 0x800) {
+      bytes.append(static_cast<char>(0xc0 | (codePoint >> 6)));
+      bytes.append(static_cast<char>(0x80 | (codePoint & 0x3f)));
+    } else if (codePoint < 0x10000) {
+      bytes.append(static_cast<char>(0xe0 | (codePoint >> 12)));
+      bytes.append(static_cast<char>(0x80 | ((codePoint >> 6) & 0x3f)));
+      bytes.append(static_cast<char>(0x80 | (codePoint & 0x3f)));
+    } else {
+      bytes.append(static_cast<char>(0xf0 | (codePoint >> 18)));
+      bytes.append(static_cast<char>(0x80 | ((codePoint >> 12) & 0x3f)));
+      bytes.append(static_cast<char>(0x80 | ((codePoint >> 6) & 0x3f)));
+      bytes.append(static_cast<char>(0x80 | (codePoint & 0x3f)));
+    }
+  }
+
+  auto readHex(std::uint32_t& value) -> bool
+  {
+    for (int i = 0; i < 4; i++) {
+
+      const auto c = takeChar();
+
+      if ((c >= '0') && (c <= '9'))
+        value = (value << 4) | static_cast<std::uint32_t>(c - '0');
+      else if ((c >= 'a') && (c <= 'f'))
+        value = (value << 4) | static_cast<std::uint32_t>(c - 'a' + 10);
+      else if ((c >= 'A') && (c <= 'F'))
+        value = (value << 4) | static_cast<std::uint32_t>(c - 'A' + 10);
+      else
+        return false;
+    }
+
+    return true;
+  }
+
+  auto peekChar() -> int
+  {
+    if (m_position == m_size) {
+
+      const auto size = m_device.read(m_buffer.data(), static_cast<qint64>(m_buffer.size()));
+
+      m_position = 0;
+      m_size = (size > 0) ? static_cast<std::size_t>(size) : 0;
+
+      if (m_size == 0)
+        return -1;
+    }
+
+    return static_cast<unsigned char>(m_buffer[m_position]);
+  }
+
+  auto takeChar() -> int
+  {
+    const auto c = peekChar();
+
+    if (c >= 0)
+      m_position++;
+
+    if (c == '\n')
+      m_lineNumber++;
+
+    return c;
+  }
+
+private:
+  QIODevice& m_device;
+
+  std::vector<char> m_buffer;
+
+  std::size_t m_position = 0;
+
+  std::size_t m_size = 0;
+
+  int m_lineNumber = 1;
+};
+
+/// @brief Reads the JSON model format, see @ref readJsonModel.
+class JsonModelReader final
+{
+public:
+  explicit JsonModelReader(QIODevice& device)
+    : m_reader(device)
+  {}
+
+  auto read(Model& model) -> bool
+  {
+    if (!m_reader.consume('{'))
+      return error("expected an object");
+
+    if (!m_reader.consume('}')) {
+
+      do {
+
+        QString key;
+
+        if (!m_reader.readString(key) || !m_reader.consume(':'))
+          return error("expected a key");
+
+        if (key == "nodes") {
+          if (!readArray(&JsonModelReader::readNode))
+            return false;
+        } else if (key == "connections") {
+          if (!readArray(&JsonModelReader::readConnection))
+            return false;
+        } else if (!m_reader.skipValue()) {
+          return error(QString("invalid value for '%1'").arg(key));
+        }
+
+      } while (m_reader.consume(','));
+
+      if (!m_reader.consume('}'))
+        return error("expected ',' or '}'");
+    }
+
+    if (m_reader.peek() != -1)
+      return error("unexpected data after the model");
+
+    if (!m_builder.finish(model))
+      return error("the connections form a cycle");
+
+    return true;
+  }
+
+  auto getErrorMessage() const -> const QString& { return m_errorMessage; }
+
+private:
+  auto error(const QString& message) -> bool
+  {
+    m_errorMessage = QString("line %1: %2").arg(m_reader.getLineNumber()).arg(message);
+    return false;
+  }
+
+  auto readArray(bool (JsonModelReader::*readElement)()) -> bool
+  {
+    if (!m_reader.consume('['))
+      return error("expected an array");
+
+    if (m_reader.consume(']'))
+      return true;
+
+    do {
+      if (!(this->*readElement)())
+        return false;
+    } while (m_reader.consume(','));
+
+    if (!m_reader.consume(']'))
+      return error("expected ',' or ']'");
+
+    return true;
+  }
+
+  /// @brief Reads the members of an object, handing each key to a function that reads its value.
+  template<typename MemberReader>
+  auto readObject(MemberReader readMember) -> bool
+  {
+    if (!m_reader.consume('{'))
+      return error("expected an object");
+
+    if (m_reader.consume('}'))
+      return true;
+
+    do {
+
+      QString key;
+
+      if (!m_reader.readString(key) || !m_reader.consume(':'))
+        return error("expected a key");
+
+      if (!readMember(key))
+        return false;
+
+    } while (m_reader.consume(','));
+
+    if (!m_reader.consume('}'))
+      return error("expected ',' or '}'");
+
+    return true;
+  }
+
+  auto readNode() -> bool
+  {
+    QString name;
+    QString kindName;
+    double x = 0;
+    double y = 0;
+
+    const bool valid = readObject([&](const QString& key) -> bool {
+      if (key == "name")
+        return m_reader.readString(name) || error("expected a string for 'name'");
+      else if (key == "kind")
+        return m_reader.readString(kindName) || error("expected a string for 'kind'");
+      else if (key == "x")
+        return m_reader.readNumber(x) || error("expected a number for 'x'");
+      else if (key == "y")
+        return m_reader.readNumber(y) || error("expected a number for 'y'");
+      else
+        return m_reader.skipValue() || error(QString("invalid value for '%1'").arg(key));
+    });
+
+    if (!valid)
+      return false;
+
+    NodeKind kind = NodeKind::Input;
+
+    if (kindName == "input")
+      kind = NodeKind::Input;
+    else if (kindName == "hidden")
+      kind = NodeKind::Hidden;
+    else if (kindName == "output")
+      kind = NodeKind::Output;
+    else
+      return error(QString("unknown node kind '%1'").arg(kindName));
+
+    if (name.isEmpty())
+      return error("the node has no name");
+
+    auto* node = m_builder.addNode(name, kind);
+
+    if (!node)
+      return error(QString("'%1' is already declared").arg(name));
+
+    node->setPosition(QVector2D(static_cast<float>(x), static_cast<float>(y)));
+
+    return true;
+  }
+
+  auto readConnection() -> bool
+  {
+    QString from;
+    QString to;
+
+    const bool valid = readObject([&](const QString& key) -> bool {
+      if (key == "from")
+        return m_reader.readString(from) || error("expected a string for 'from'");
+      else if (key == "to")
+        return m_reader.readString(to) || error("expected a string for 'to'");
+      else
+        return m_reader.skipValue() || error(QString("invalid value for '%1'").arg(key));
+    });
+
+    if (!valid)
+      return false;
+
+    QString message;
+
+    if (!m_builder.connect(from, to, message))
+      return error(message);
+
+    return true;
+  }
+
+private:
+  JsonReader m_reader;
+
+  ModelBuilder m_builder;
+
+  QString m_errorMessage;
+};
+
+} // namespace
+
+auto
+readTextModel(QIODevice& device, Model& model, QString* errorMessage) -> bool
+{
+  QTextStream stream(&device);
+
+  ModelBuilder builder;
+
+  QString line;
+
+  QString message;
+
+  int lineNumber = 0;
+
+  while (stream.readLineInto(&line)) {
+
+    lineNumber++;
+
+    line = line.simplified();
+
+    if (line.isEmpty() || line.startsWith('#'))
+      continue;
+
+    const QStringList words = line.split(' ');
+
+    const QString& keyword = words[0];
+
+    if (keyword == "connect") {
+
+      if (words.size() != 3)
+        return fail(errorMessage, lineNumber, "expected 'connect <from> <to>'");
+
+      if (!builder.connect(words[1], words[2], message))
+        return fail(errorMessage, lineNumber, message);
+
+      continue;
+    }
+
+    NodeKind kind = NodeKind::Input;
+
+    if (keyword == "input")
+      kind = NodeKind::Input;
+    else if (keyword == "hidden")
+      kind = NodeKind::Hidden;
+    else if (keyword == "output")
+      kind = NodeKind::Output;
+    else
+      return fail(errorMessage, lineNumber, QString("unknown keyword '%1'").arg(keyword));
+
+    if ((words.size() != 2) && (words.size() != 4))
+      return fail(errorMessage, lineNumber, QString("expected '%1 <name> [x y]'").arg(keyword));
+
+    QVector2D position(0, 0);
+
+    if (words.size() == 4) {
+
+      bool xValid = false;
+      bool yValid = false;
+
+      position = QVector2D(words[2].toFloat(&xValid), words[3].toFloat(&yValid));
+
+      if (!xValid || !yValid)
+        return fail(errorMessage, lineNumber, "invalid position");
+    }
+
+    auto* node = builder.addNode(words[1], kind);
+
+    if (!node)
+      return fail(errorMessage, lineNumber, QString("'%1' is already declared").arg(words[1]));
+
+    node->setPosition(position);
+  }
+
+  if (!builder.finish(model))
+    return fail(errorMessage, lineNumber, "the connections form a cycle");
+
+  return true;
+}
+
+auto
+loadTextModel(const QString& path, Model& model, QString* errorMessage) -> bool
+{
+  QFile file(path);
+
+  if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+    if (errorMessage)
+      *errorMessage = file.errorString();
+    return false;
+  }
+
+  return readTextModel(file, model, errorMessage);
+}
+
+auto
+readJsonModel(QIODevice& device, Model& model, QString* errorMessage) -> bool
+{
+  JsonModelReader reader(device);
+
+  if (reader.read(model))
+    return true;
+
+  if (errorMessage)
+    *errorMessage = reader.getErrorMessage();
+
+  return false;
+}
+
+auto
+loadJsonModel(const QString& path, Model& model, QString* errorMessage) -> bool
+{
+  QFile file(path);
+
+  if (!file.open(QIODevice::ReadOnly)) {
+    if (errorMessage)
+      *errorMessage = file.errorString();
+    return false;
+  }
+
+  return readJsonModel(file, model, errorMessage);
+}
+
+auto
+writeTextModel(const Model& model, QIODevice& device, QString* errorMessage) -> bool
+{
+  QTextStream stream(&device);
+
+  QHash<const Node*, QString> names;
+
+  auto declare = [&](const char* keyword, const char* prefix, const QVector<std::shared_ptr<Node>>& nodes) {
+    for (int i = 0; i < nodes.size(); i++) {
+      const QString name = prefix + QString::number(i);
+      const QVector2D position = nodes[i]->getPosition();
+      names.insert(nodes[i].get(), name);
+      stream << keyword << ' ' << name << ' ' << position.x() << ' ' << position.y() << '\n';
+    }
+  };
+
+  declare("input", "i", model.getInputNodes());
+  declare("hidden", "h", model.getHiddenNodes());
+  declare("output", "o", model.getOutputNodes());
+
+  auto connect = [&](const QVector<std::shared_ptr<Node>>& nodes) {
+    for (const auto& node : nodes) {
+      for (const auto& connection : node->getConnections()) {
+        const auto it = names.find(connection.get());
+        if (it != names.end())
+          stream << "connect " << *it << ' ' << names[node.get()] << '\n';
+      }
+    }
+  };
+
+  connect(model.getHiddenNodes());
+  connect(model.getOutputNodes());
+
+  stream.flush();
+
+  if (stream.status() != QTextStream::Ok) {
+    if (errorMessage)
+      *errorMessage = device.errorString();
+    return false;
+  }
+
+  return true;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <QString>
+
+class Model;
+class QIODevice;
+
+/// @brief Reads a model written in the line based text format.
+///
+/// @detail Each line declares a node or a connection. Blank lines and lines starting with '#' are ignored.
+///
+///         @code
+///         input <name> [x y]
+///         hidden <name> [x y]
+///         output <name> [x y]
+///         connect <from> <to>
+///         @endcode
+///
+///         Names are words without whitespace, and a node has to be declared before it is connected. A connection
+///         feeds the value of the first node into the second one. Hidden nodes may feed other hidden nodes, as long as
+///         no cycle is formed. The optional coordinates are the position of the node in the model view.
+///
+///         The input is read a line at a time. The nodes are built and connected on the side and only added to the
+///         model once the whole input has been read, with @ref Model::appendNodes, so reading a large model emits a
+///         single change.
+///
+/// @param errorMessage If not null, receives a description of the first problem found, with its line number.
+///
+/// @return True on success. On failure, the model is left unchanged.
+auto
+readTextModel(QIODevice& device, Model& model, QString* errorMessage = nullptr) -> bool;
+
+/// @brief Opens a file and reads a model from it, as described in @ref readTextModel.
+auto
+loadTextModel(const QString& path, Model& model, QString* errorMessage = nullptr) -> bool;
+
+/// @brief Reads a model written as JSON, such as one exported from another tool.
+///
+/// @detail The document is an object with an array of nodes and an array of connections, which work the same way as
+///         in @ref readTextModel. Other members are ignored.
+///
+///         @code
+///         {
+///           "nodes": [
+///             { "name": "a", "kind": "input", "x": 0, "y": 0 },
+///             { "name": "b", "kind": "output" }
+///           ],
+///           "connections": [
+///             { "from": "a", "to": "b" }
+///           ]
+///         }
+///         @endcode
+///
+///         The input is parsed as it is read, a block at a time, and never held in memory as a whole. For that reason
+///         the nodes have to come before the connections that refer to them.
+///
+/// @param errorMessage If not null, receives a description of the first problem found, with its line number.
+///
+/// @return True on success. On failure, the model is left unchanged.
+auto
+readJsonModel(QIODevice& device, Model& model, QString* errorMessage = nullptr) -> bool;
+
+/// @brief Opens a file and reads a model from it, as described in @ref readJsonModel.
+auto
+loadJsonModel(const QString& path, Model& model, QString* errorMessage = nullptr) -> bool;
+
+/// @brief Writes a model in the format read by @ref readTextModel.
+///
+/// @detail Nodes are named after their kind and position in the model, such as "h3" for the fourth hidden node.
+///
+/// @param errorMessage If not null, receives a description of the problem on failure.
+auto
+writeTextModel(const Model& model, QIODevice& device, QString* errorMessage = nullptr) -> bool;
@@ -3,6 +3,7 @@
 #include "model.h"
 #include "node.h"
 
+#include <QImage>
 #include <QMenu>
 #include <QMouseEvent>
 #include <QPainter>
@@ -13,9 +14,67 @@
 #endif
 
 #include <algorithm>
+#include <cmath>
 
 #include <QDebug>
 
+namespace {
+
+/// @brief The number of visible connections above which they are painted without antialiasing, which is several times
+///        slower and makes no visible difference once the lines overlap this much.
+constexpr std::size_t g_maxAntialiasedConnections = 2000;
+
+/// @brief The number of visible connections above which they are painted as a density map.
+constexpr std::size_t g_maxPaintedConnections = 20000;
+
+/// @brief The size of the cells of the density map, in pixels.
+constexpr int g_densityCellSize = 4;
+
+/// @brief Checks whether the bounding box of a line segment overlaps a rectangle. This lets through some segments that
+///        pass by a corner, which is fine for culling.
+auto
+isLineInRect(const QPointF& a, const QPointF& b, const QRectF& rect) -> bool
+{
+  return (std::max(a.x(), b.x()) >= rect.left()) && (std::min(a.x(), b.x()) <= rect.right()) &&
+         (std::max(a.y(), b.y()) >= rect.top()) && (std::min(a.y(), b.y()) <= rect.bottom());
+}
+
+/// @brief Clips a line segment to the rectangle between the origin and a corner, with the Liang-Barsky algorithm.
+///
+/// @return False if no part of the segment is within the rectangle.
+auto
+clipLine(QPointF& a, QPointF& b, const QPointF& corner) -> bool
+{
+  const auto delta = b - a;
+
+  const qreal p[4]{ -delta.x(), delta.x(), -delta.y(), delta.y() };
+  const qreal q[4]{ a.x(), corner.x() - a.x(), a.y(), corner.y() - a.y() };
+
+  qreal t0 = 0;
+  qreal t1 = 1;
+
+  for (int i = 0; i < 4; i++) {
+    if (p[i] == 0) {
+      if (q[i] < 0)
+        return false;
+    } else if (p[i] < 0) {
+      t0 = std::max(t0, q[i] / p[i]);
+    } else {
+      t1 = std::min(t1, q[i] / p[i]);
+    }
+  }
+
+  if (t0 > t1)
+    return false;
+
+  b = a + (delta * t1);
+  a = a + (delta * t0);
+
+  return true;
+}
+
+} // namespace
+
 ModelView::ModelView(Model* model, QWidget* parent)
   : QWidget(parent)
   , m_model(model)
@@ -25,6 +84,25 @@ ModelView::ModelView(Model* model, QWidget* parent)
   connect(this, &QWidget::customContextMenuRequested, this, &ModelView::showContextMenu);
 
   setContextMenuPolicy(Qt::CustomContextMenu);
+
+  for (const auto* nodes : { &m_model->getInputNodes(), &m_model->getHiddenNodes(), &m_model->getOutputNodes() }) {
+    for (const auto& node : *nodes)
+      m_nodeGrid.insert(node.get());
+  }
+
+  connect(m_model, &Model::nodeAdded, this, [this](Node* node) { m_nodeGrid.insert(node); });
+
+  /* Nodes may also be removed by others, such as when a model is opened, so the view lets go of them here. */
+
+  connect(m_model, &Model::nodeRemoved, this, [this](Node* node) {
+    m_nodeGrid.remove(node);
+    if (node == m_controlState.connectTarget.get())
+      m_controlState.connectTarget = nullptr;
+    if (node == m_controlState.moveTarget.get())
+      m_controlState.moveTarget = nullptr;
+  });
+
+  connect(m_model, &Model::modelChanged, this, qOverload<>(&QWidget::update));
 }
 
 void
@@ -109,6 +187,7 @@ ModelView::mouseMoveEvent(QMouseEvent* mouseEvent)
     } else if (m_controlState.moveTarget) {
       Node* node = m_controlState.moveTarget.get();
       node->setPosition(node->getPosition() + QVector2D(delta.x(), delta.y()));
+      m_nodeGrid.update(node);
     }
 
     m_controlState.mouseX = mouseEvent->position().x();
@@ -165,31 +244,33 @@ ModelView::paintNodes(QPainter& painter)
 {
   painter.setTransform(getViewTransform());
 
-  painter.setPen(QPen(Qt::NoPen));
+  painter.setRenderHint(QPainter::Antialiasing);
 
-  painter.setBrush(QBrush(QColor(0xff, 0xcc, 0)));
+  const auto visibleRect = getVisibleRect(getNodeRadius());
 
-  for (const auto& node : m_model->getInputNodes()) {
-    const auto p = node->getPosition().toPointF();
-    const auto r = getNodeRadius();
-    painter.drawEllipse(p, r, r);
-  }
+  paintNodes(painter, m_model->getInputNodes(), QColor(0xff, 0xcc, 0), visibleRect);
 
-  painter.setBrush(QBrush(QColor(0xcc, 0xcc, 0x00)));
+  paintNodes(painter, m_model->getHiddenNodes(), QColor(0xcc, 0xcc, 0x00), visibleRect);
 
-  for (const auto& node : m_model->getHiddenNodes()) {
-    const auto p = node->getPosition().toPointF();
-    const auto r = getNodeRadius();
-    painter.drawEllipse(p, r, r);
-  }
+  paintNodes(painter, m_model->getOutputNodes(), QColor(0xff, 0x66, 0x00), visibleRect);
+}
+
+void
+ModelView::paintNodes(QPainter& painter, const NodeVector& nodes, const QColor& color, const QRectF& visibleRect)
+{
+  /* The nodes are painted as points with a round pen as wide as a node, so that all of them take a single call. */
 
-  painter.setBrush(QBrush(QColor(0xff, 0x66, 0x00)));
+  m_visibleNodes.clear();
 
-  for (const auto& node : m_model->getOutputNodes()) {
+  for (const auto& node : nodes) {
     const auto p = node->getPosition().toPointF();
-    const auto r = getNodeRadius();
-    painter.drawEllipse(p, r, r);
+    if (visibleRect.contains(p))
+      m_visibleNodes.emplace_back(p);
   }
+
+  painter.setPen(QPen(QBrush(color), getNodeRadius() * 2, Qt::SolidLine, Qt::RoundCap));
+
+  painter.drawPoints(m_visibleNodes.data(), static_cast<int>(m_visibleNodes.size()));
 }
 
 void
@@ -205,29 +286,118 @@ ModelView::paintConnections(QPainter& painter)
     painter.drawLine(a.toPointF(), b);
   }
 
-  for (const auto& node : m_model->getInputNodes()) {
-    for (const auto& connectedNode : node->getConnections()) {
+  const auto visibleRect = getVisibleRect(getStrokeSize());
+
+  m_visibleConnections.clear();
+
+  for (const auto* nodes : { &m_model->getInputNodes(), &m_model->getHiddenNodes(), &m_model->getOutputNodes() }) {
+    for (const auto& node : *nodes) {
       const auto p0 = node->getPosition().toPointF();
-      const auto p1 = connectedNode->getPosition().toPointF();
-      painter.drawLine(p0, p1);
+      for (const auto& connectedNode : node->getConnections()) {
+        const auto p1 = connectedNode->getPosition().toPointF();
+        if (isLineInRect(p0, p1, visibleRect))
+          m_visibleConnections.emplace_back(p0, p1);
+      }
     }
   }
 
-  for (const auto& node : m_model->getHiddenNodes()) {
-    for (const auto& connectedNode : node->getConnections()) {
-      const auto p0 = node->getPosition().toPointF();
-      const auto p1 = connectedNode->getPosition().toPointF();
-      painter.drawLine(p0, p1);
+  if (m_visibleConnections.size() > g_maxPaintedConnections) {
+    paintConnectionDensity(painter);
+    return;
+  }
+
+  painter.setRenderHint(QPainter::Antialiasing, m_visibleConnections.size() <= g_maxAntialiasedConnections);
+
+  painter.drawLines(m_visibleConnections.data(), static_cast<int>(m_visibleConnections.size()));
+}
+
+void
+ModelView::paintConnectionDensity(QPainter& painter)
+{
+  const int columnCount = (width() + g_densityCellSize - 1) / g_densityCellSize;
+
+  const int rowCount = (height() + g_densityCellSize - 1) / g_densityCellSize;
+
+  if ((columnCount <= 0) || (rowCount <= 0))
+    return;
+
+  m_densityCounts.assign(static_cast<std::size_t>(columnCount) * rowCount, 0);
+
+  /* Each connection counts once in every cell it passes through, sampled about once per cell along its length. It is
+   * clipped to the view first, so that zooming in on a long connection doesn't make it take longer. */
+
+  const auto transform = getViewTransform();
+
+  const QPointF corner(columnCount, rowCount);
+
+  std::uint32_t maxCount = 0;
+
+  for (const auto& line : m_visibleConnections) {
+
+    auto p0 = transform.map(line.p1()) / g_densityCellSize;
+    auto p1 = transform.map(line.p2()) / g_densityCellSize;
+
+    if (!clipLine(p0, p1, corner))
+      continue;
+
+    const auto delta = p1 - p0;
+
+    const int sampleCount = static_cast<int>(std::max(std::abs(delta.x()), std::abs(delta.y()))) + 1;
+
+    const auto step = delta / sampleCount;
+
+    auto p = p0 + (step / 2);
+
+    for (int i = 0; i < sampleCount; i++, p += step) {
+
+      const auto x = static_cast<int>(std::floor(p.x()));
+      const auto y = static_cast<int>(std::floor(p.y()));
+
+      if ((x < 0) || (x >= columnCount) || (y < 0) || (y >= rowCount))
+        continue;
+
+      auto& count = m_densityCounts[(static_cast<std::size_t>(y) * columnCount) + x];
+
+      count++;
+
+      maxCount = std::max(maxCount, count);
     }
   }
 
-  for (const auto& node : m_model->getOutputNodes()) {
-    for (const auto& connectedNode : node->getConnections()) {
-      const auto p0 = node->getPosition().toPointF();
-      const auto p1 = connectedNode->getPosition().toPointF();
-      painter.drawLine(p0, p1);
+  if (maxCount == 0)
+    return;
+
+  /* The counts are shown on a log scale, since the cells around nodes with many connections are far more crowded
+   * than the rest. */
+
+  QImage image(columnCount, rowCount, QImage::Format_ARGB32_Premultiplied);
+
+  const float scale = 1.0f / std::log1p(static_cast<float>(maxCount));
+
+  for (int y = 0; y < rowCount; y++) {
+
+    auto* row = reinterpret_cast<QRgb*>(image.scanLine(y));
+
+    const auto* counts = m_densityCounts.data() + (static_cast<std::size_t>(y) * columnCount);
+
+    for (int x = 0; x < columnCount; x++) {
+      const float v = std::log1p(static_cast<float>(counts[x])) * scale;
+      const int alpha = static_cast<int>(v * 255);
+      const int gray = static_cast<int>(v * (100 + (v * 155)));
+      row[x] = qRgba(gray, gray, gray, alpha);
     }
   }
+
+  /* The image is scaled up by a whole factor onto pixel boundaries, so antialiasing the edges of it would only cost
+   * time. */
+
+  painter.resetTransform();
+
+  painter.setRenderHint(QPainter::Antialiasing, false);
+
+  painter.setRenderHint(QPainter::SmoothPixmapTransform);
+
+  painter.drawImage(QRectF(0, 0, columnCount * g_densityCellSize, rowCount * g_densityCellSize), image);
 }
 
 auto
@@ -242,12 +412,6 @@ ModelView::createPen(Qt::PenStyle style, const QColor& color) -> QPen
 void
 ModelView::destroyNode(Node* node)
 {
-  if (node == m_controlState.connectTarget.get())
-    m_controlState.connectTarget = nullptr;
-
-  if (node == m_controlState.moveTarget.get())
-    m_controlState.moveTarget = nullptr;
-
   m_model->destroyNode(node);
 }
 
@@ -304,39 +468,16 @@ ModelView::integrateNewNode(Node* node, const QPoint& point)
 {
   node->setPosition(QVector2D(point));
 
-  update();
-}
-
-auto
-ModelView::isNodeIntersected(const QVector2D& point, const Node& node, float nodeRadius) -> bool
-{
-  const auto delta = point - node.getPosition();
-
-  return QVector2D::dotProduct(delta, delta) < (nodeRadius * nodeRadius);
-}
-
-auto
-ModelView::findNodeIntersection(const QVector2D& point, const NodeVector& nodes, float nodeRadius) -> std::shared_ptr<Node>
-{
-  for (auto& node : nodes) {
-    if (isNodeIntersected(point, *node, nodeRadius))
-      return node;
-  }
+  m_nodeGrid.update(node);
 
-  return nullptr;
+  update();
 }
 
 auto
 ModelView::findNodeIntersection(const QVector2D& point, float nodeRadius) -> std::shared_ptr<Node>
 {
-  if (auto node = findNodeIntersection(point, m_model->getInputNodes(), nodeRadius))
-    return node;
-
-  if (auto node = findNodeIntersection(point, m_model->getHiddenNodes(), nodeRadius))
-    return node;
-
-  if (auto node = findNodeIntersection(point, m_model->getOutputNodes(), nodeRadius))
-    return node;
+  if (auto* node = m_nodeGrid.findNearest(point, nodeRadius))
+    return node->shared_from_this();
 
   return nullptr;
 }
@@ -350,6 +491,14 @@ ModelView::getViewTransform() const
   return QTransform::fromTranslate(tx, ty) * QTransform::fromScale(scale, scale);
 }
 
+auto
+ModelView::getVisibleRect(float margin) const -> QRectF
+{
+  const auto visibleRect = getViewTransform().inverted().mapRect(QRectF(rect()));
+
+  return visibleRect.adjusted(-margin, -margin, margin, margin);
+}
+
 QTransform
 ModelView::getGridTransform() const
 {
@@ -1,13 +1,21 @@
 #ifndef MODELVIEW_H
 #define MODELVIEW_H
 
+#include <QLineF>
+#include <QPointF>
 #include <QWidget>
 #include <QVector>
 
+#include "nodegrid.h"
+
+#include <cstdint>
+#include <vector>
+
 class Node;
 class Model;
 class QTransform;
 class QPen;
+class QRectF;
 
 class ModelView : public QWidget
 {
@@ -38,8 +46,15 @@ private:
 
   void paintNodes(QPainter&);
 
+  /// @brief Paints the nodes of one kind that are within a rectangle, in model coordinates.
+  void paintNodes(QPainter&, const NodeVector& nodes, const QColor& color, const QRectF& visibleRect);
+
   void paintConnections(QPainter&);
 
+  /// @brief Paints the visible connections as a map of how many pass through each part of the view, for when there
+  ///        are too many of them to draw one by one.
+  void paintConnectionDensity(QPainter&);
+
   void showContextMenu(const QPoint&);
 
   void showBackgroundContextMenu(const QPoint&);
@@ -48,10 +63,6 @@ private:
 
   void integrateNewNode(Node* node, const QPoint&);
 
-  auto isNodeIntersected(const QVector2D& point, const Node& node, float nodeRadius) -> bool;
-
-  auto findNodeIntersection(const QVector2D& point, const NodeVector& nodes, float nodeRadius) -> std::shared_ptr<Node>;
-
   auto findNodeIntersection(const QVector2D& point, float nodeRadius = getNodeRadius()) -> std::shared_ptr<Node>;
 
   void destroyNode(Node* node);
@@ -68,6 +79,9 @@ private:
 
   auto getViewTransform() const -> QTransform;
 
+  /// @brief Gets the part of the model that is in view, in model coordinates, grown by a margin on each side.
+  auto getVisibleRect(float margin) const -> QRectF;
+
   static auto createPen(Qt::PenStyle, const QColor& color) -> QPen;
 
   struct ControlState final
@@ -95,6 +109,17 @@ private:
   ControlState m_controlState;
 
   Model* m_model;
+
+  /// @brief Indexes the nodes by position, for hit testing. It is kept up to date with the model and with the moves
+  ///        made in this view.
+  NodeGrid m_nodeGrid{ getCellSize() };
+
+  /// @brief Scratch space for painting, kept between frames so that it doesn't have to be allocated again.
+  std::vector<QPointF> m_visibleNodes;
+
+  std::vector<QLineF> m_visibleConnections;
+
+  std::vector<std::uint32_t> m_densityCounts;
 };
 
 #endif // MODELVIEW_H
@@ -0,0 +1,531 @@
+/* Generates C++ headers for many models at once, without a user interface.
+ *
+ * Each model is loaded, compiled, optimized and turned into code on its own task of a thread pool, so that a large set
+ * of models keeps every core busy. The time taken by each model is printed once all of them are done, in the order
+ * they were given on the command line. */
+
+#include "compiler.h"
+#include "cxxemitter.h"
+#include "graph.h"
+#include "model.h"
+#include "modelfile.h"
+#include "modelio.h"
+#include "optimizer.h"
+#include "quantizer.h"
+#include "threadpool.h"
+
+#include <QCommandLineOption>
+#include <QCommandLineParser>
+#include <QByteArray>
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QTextStream>
+
+#include <chrono>
+#include <vector>
+
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+/// @brief What happened to one model.
+struct Job final
+{
+  QString modelPath;
+
+  QString headerPath;
+
+  /// @brief Where to write the model in the binary format, if anywhere.
+  QString binaryPath;
+
+  /// @brief Where to write the quantized parameters, if anywhere.
+  QString quantizedPath;
+
+  QString className;
+
+  /// @brief Empty if the header was written.
+  QString error;
+
+  std::size_t exprCount = 0;
+
+  double loadSeconds = 0;
+
+  double compileSeconds = 0;
+
+  double generateSeconds = 0;
+
+  QuantizationError quantizationError;
+};
+
+/// @brief The settings shared by all models.
+struct Settings final
+{
+  QString outputDirectory;
+
+  QString namespaceName;
+
+  CxxEmitter::NumberFormat numberFormat = CxxEmitter::NumberFormat::Scalar;
+
+  CxxEmitter::SimdTarget simdTarget = CxxEmitter::SimdTarget::None;
+
+  bool optimize = true;
+
+  bool writeBinary = false;
+
+  /// @brief The parameters given on the command line, if any, for a single model.
+  std::vector<float> parameters;
+
+  /// @brief The samples to calibrate quantized models with, one after the other.
+  std::vector<float> calibrationSamples;
+};
+
+/// @brief Turns a file name into a valid C++ identifier, for the name of the model class.
+auto
+toIdentifier(const QString& name) -> QString
+{
+  QString identifier;
+
+  for (int i = 0; i < name.size(); i++)
+    identifier += name.at(i).isLetterOrNumber() ? name.at(i) : QChar('_');
+
+  if (identifier.isEmpty() || identifier.at(0).isDigit())
+    identifier = "_" + identifier;
+
+  return identifier;
+}
+
+auto
+secondsSince(std::chrono::steady_clock::time_point start) -> double
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/// @brief Reads a file of 32-bit floats, stored in the byte order of the machine.
+auto
+readFloats(const QString& path, std::vector<float>& values, QString* errorMessage) -> bool
+{
+  QFile file(path);
+
+  if (!file.open(QIODevice::ReadOnly)) {
+    *errorMessage = file.errorString();
+    return false;
+  }
+
+  const QByteArray data = file.readAll();
+
+  if ((data.size() % sizeof(float)) != 0) {
+    *errorMessage = "the size of the file is not a multiple of the size of a float";
+    return false;
+  }
+
+  values.resize(data.size() / sizeof(float));
+
+  std::memcpy(values.data(), data.constData(), data.size());
+
+  return true;
+}
+
+/// @brief Writes the buffers that a model generated with the int8 number format is constructed from.
+///
+/// @detail The buffers are written one after the other, in the byte order of the machine: the weights, padded with
+///         zeros to a multiple of four bytes, the biases, the requantization pairs, the scale of the inputs and the
+///         scale of each output.
+auto
+writeQuantizedParameters(const QuantizedParameters& parameters, QIODevice& device) -> bool
+{
+  auto write = [&device](const void* data, std::size_t size) -> bool {
+    return device.write(static_cast<const char*>(data), static_cast<qint64>(size)) == static_cast<qint64>(size);
+  };
+
+  const char padding[sizeof(std::int32_t)]{};
+
+  const std::size_t paddingSize = (sizeof(std::int32_t) - (parameters.weights.size() % sizeof(std::int32_t))) %
+                                  sizeof(std::int32_t);
+
+  return write(parameters.weights.data(), parameters.weights.size()) && write(padding, paddingSize) &&
+         write(parameters.biases.data(), parameters.biases.size() * sizeof(std::int32_t)) &&
+         write(parameters.requantization.data(), parameters.requantization.size() * sizeof(std::int32_t)) &&
+         write(&parameters.inputScale, sizeof(float)) &&
+         write(parameters.outputScales.data(), parameters.outputScales.size() * sizeof(float));
+}
+
+/// @brief Calibrates a program with the samples of the settings, and writes its quantized parameters.
+///
+/// @param parameters The floating point parameters, from the command line or from the model file.
+void
+quantizeJob(Job& job,
+            const Settings& settings,
+            const Program& program,
+            const float* parameters,
+            std::size_t parameterCount)
+{
+  if (!parameters) {
+    job.error = "there are no parameters to quantize, since the model file has none and --parameters is not set";
+    return;
+  }
+
+  if (parameterCount != program.getParameterCount()) {
+    job.error = QString("expected %1 parameters, not %2").arg(program.getParameterCount()).arg(parameterCount);
+    return;
+  }
+
+  const std::size_t inputCount = program.getInputCount();
+
+  const std::size_t sampleCount = (inputCount > 0) ? (settings.calibrationSamples.size() / inputCount) : 0;
+
+  if ((sampleCount == 0) || ((sampleCount * inputCount) != settings.calibrationSamples.size())) {
+    job.error = QString("the calibration samples don't divide into samples of %1 inputs").arg(inputCount);
+    return;
+  }
+
+  Quantizer quantizer(program);
+
+  quantizer.calibrate(parameters, settings.calibrationSamples.data(), sampleCount);
+
+  const QuantizedParameters quantized = quantizer.quantize(parameters);
+
+  /* The samples double as a check of the accuracy, against the floating point program. */
+
+  job.quantizationError =
+    quantizer.measureError(parameters, quantized, settings.calibrationSamples.data(), sampleCount);
+
+  QFile file(job.quantizedPath);
+
+  if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate) || !writeQuantizedParameters(quantized, file))
+    job.error = file.errorString();
+}
+
+void
+runJob(Job& job, const Settings& settings)
+{
+  auto start = std::chrono::steady_clock::now();
+
+  /* Binary model files are compiled straight from the mapping, without building a model. */
+
+  Model model;
+
+  Graph graph;
+
+  ModelFile modelFile;
+
+  GraphView graphView = graph;
+
+  const QString suffix = QFileInfo(job.modelPath).suffix();
+
+  if (suffix == "nnm") {
+
+    if (!modelFile.open(job.modelPath, &job.error) || !modelFile.verify(&job.error))
+      return;
+
+    graphView = modelFile.getGraph();
+
+  } else {
+
+    const bool loaded = (suffix == "json") ? loadJsonModel(job.modelPath, model, &job.error)
+                                           : loadTextModel(job.modelPath, model, &job.error);
+
+    if (!loaded)
+      return;
+
+    if (!job.binaryPath.isEmpty()) {
+
+      /* The parameters given on the command line are stored along with the model. */
+
+      const auto& parameters = settings.parameters;
+
+      const std::size_t parameterCount = std::size_t(model.getConnectionCount()) * 2;
+
+      if (!parameters.empty() && (parameters.size() != parameterCount)) {
+        job.error = QString("expected %1 parameters, not %2").arg(parameterCount).arg(parameters.size());
+        return;
+      }
+
+      QFile binaryFile(job.binaryPath);
+
+      const float* data = parameters.empty() ? nullptr : parameters.data();
+
+      const auto count = static_cast<std::uint32_t>(parameters.size());
+
+      if (!binaryFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        job.error = binaryFile.errorString();
+        return;
+      }
+
+      if (!writeModelFile(model, binaryFile, data, count, &job.error))
+        return;
+    }
+
+    graph = Graph(model);
+
+    graphView = graph;
+  }
+
+  job.loadSeconds = secondsSince(start);
+
+  start = std::chrono::steady_clock::now();
+
+  Program program = Compiler(graphView).compile();
+
+  if (settings.optimize)
+    optimize(program);
+
+  job.exprCount = program.size();
+
+  if (!job.quantizedPath.isEmpty()) {
+
+    /* Parameters given on the command line take precedence over those stored in a binary model file. */
+
+    if (!settings.parameters.empty())
+      quantizeJob(job, settings, program, settings.parameters.data(), settings.parameters.size());
+    else
+      quantizeJob(job, settings, program, modelFile.getParameters(), modelFile.getParameterCount());
+
+    if (!job.error.isEmpty())
+      return;
+  }
+
+  job.compileSeconds = secondsSince(start);
+
+  start = std::chrono::steady_clock::now();
+
+  CxxEmitter emitter;
+
+  emitter.setNamespace(settings.namespaceName);
+  emitter.setModelClassName(job.className);
+  emitter.setNumberFormat(settings.numberFormat);
+  emitter.setSimdTarget(settings.simdTarget);
+
+  const QString code = emitter.generate(program);
+
+  QFile file(job.headerPath);
+
+  if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+    job.error = file.errorString();
+    return;
+  }
+
+  QTextStream stream(&file);
+
+  stream << code;
+
+  stream.flush();
+
+  job.generateSeconds = secondsSince(start);
+}
+
+/// @brief Looks up a command line value in a list of names, whose order matches an enumeration.
+template<typename Enum, std::size_t N>
+auto
+parseChoice(const QString& value, const char* const (&names)[N], Enum& result) -> bool
+{
+  for (std::size_t i = 0; i < N; i++) {
+    if (value == names[i]) {
+      result = static_cast<Enum>(i);
+      return true;
+    }
+  }
+
+  return false;
+}
+
+const char* const g_numberFormatNames[]{ "scalar", "int8" };
+
+const char* const g_simdTargetNames[]{ "none", "vector-extensions", "sse", "avx2", "avx512", "neon" };
+
+} // namespace
+
+int
+main(int argc, char** argv)
+{
+  QCoreApplication app(argc, argv);
+
+  app.setApplicationName("nngen-cli");
+
+  QCommandLineParser parser;
+
+  parser.setApplicationDescription("Generates a C++ header for each model file.");
+  parser.addHelpOption();
+  parser.addPositionalArgument("models",
+                               "The model files, in the text format or, if named *.json or *.nnm, in JSON or the "
+                               "binary format.",
+                               "<models...>");
+
+  const QCommandLineOption outputOption(QStringList{ "o", "output" },
+                                        "The directory to write headers to. By default, each header is written next "
+                                        "to its model.",
+                                        "directory");
+
+  const QCommandLineOption namespaceOption(
+    QStringList{ "n", "namespace" }, "The namespace of the models. By default, an anonymous one.", "name");
+
+  const QCommandLineOption numberFormatOption(
+    "number-format", "The number format: scalar (default) or int8.", "format", "scalar");
+
+  const QCommandLineOption simdOption("simd",
+                                      "The SIMD target: none (default), vector-extensions, sse, avx2, avx512 or neon.",
+                                      "target",
+                                      "none");
+
+  const QCommandLineOption noOptimizeOption("no-optimize", "Generate code for the program as compiled.");
+
+  const QCommandLineOption writeBinaryOption(
+    "write-binary",
+    "Also write each text model in the binary format, as a .nnm file next to its header, along with the parameters if "
+    "they are given.");
+
+  const QCommandLineOption parametersOption(
+    "parameters",
+    "The weights and biases of the model, as 32-bit floats in the order of the connections, all weights first. By "
+    "default, those stored in a binary model file are used. Only valid with a single model.",
+    "file");
+
+  const QCommandLineOption calibrationOption(
+    "calibration",
+    "Calibrate int8 models with the samples in this file, as 32-bit floats one sample after the other, and write their "
+    "quantized parameters to a .qparams file next to each header. The error against floating point is printed.",
+    "file");
+
+  const QCommandLineOption jobsOption(
+    QStringList{ "j", "jobs" }, "The number of threads. By default, one per hardware thread.", "count", "0");
+
+  parser.addOption(outputOption);
+  parser.addOption(namespaceOption);
+  parser.addOption(numberFormatOption);
+  parser.addOption(simdOption);
+  parser.addOption(noOptimizeOption);
+  parser.addOption(writeBinaryOption);
+  parser.addOption(parametersOption);
+  parser.addOption(calibrationOption);
+  parser.addOption(jobsOption);
+
+  parser.process(app);
+
+  Settings settings;
+
+  settings.outputDirectory = parser.value(outputOption);
+  settings.namespaceName = parser.value(namespaceOption);
+  settings.optimize = !parser.isSet(noOptimizeOption);
+  settings.writeBinary = parser.isSet(writeBinaryOption);
+
+  if (!parseChoice(parser.value(numberFormatOption), g_numberFormatNames, settings.numberFormat)) {
+    std::fprintf(stderr, "Unknown number format '%s'.\n", qPrintable(parser.value(numberFormatOption)));
+    return 1;
+  }
+
+  if (!parseChoice(parser.value(simdOption), g_simdTargetNames, settings.simdTarget)) {
+    std::fprintf(stderr, "Unknown SIMD target '%s'.\n", qPrintable(parser.value(simdOption)));
+    return 1;
+  }
+
+  bool jobCountValid = false;
+
+  const int threadCount = parser.value(jobsOption).toInt(&jobCountValid);
+
+  if (!jobCountValid || (threadCount < 0)) {
+    std::fprintf(stderr, "Invalid number of jobs '%s'.\n", qPrintable(parser.value(jobsOption)));
+    return 1;
+  }
+
+  const QStringList modelPaths = parser.positionalArguments();
+
+  if (modelPaths.isEmpty())
+    parser.showHelp(1);
+
+  const bool calibrate = parser.isSet(calibrationOption);
+
+  if (calibrate && (settings.numberFormat != CxxEmitter::NumberFormat::Int8)) {
+    std::fprintf(stderr, "--calibration requires --number-format int8.\n");
+    return 1;
+  }
+
+  if (parser.isSet(parametersOption) && (modelPaths.size() != 1)) {
+    std::fprintf(stderr, "Parameters can only be given for a single model.\n");
+    return 1;
+  }
+
+  for (const auto* option : { &parametersOption, &calibrationOption }) {
+
+    if (!parser.isSet(*option))
+      continue;
+
+    auto& values = (option == &parametersOption) ? settings.parameters : settings.calibrationSamples;
+
+    QString error;
+
+    if (!readFloats(parser.value(*option), values, &error)) {
+      std::fprintf(stderr, "%s: %s\n", qPrintable(parser.value(*option)), qPrintable(error));
+      return 1;
+    }
+  }
+
+  std::vector<Job> jobs(modelPaths.size());
+
+  for (int i = 0; i < modelPaths.size(); i++) {
+
+    const QFileInfo modelInfo(modelPaths[i]);
+
+    const QDir outputDirectory = settings.outputDirectory.isEmpty() ? modelInfo.dir() : QDir(settings.outputDirectory);
+
+    jobs[i].modelPath = modelPaths[i];
+    jobs[i].headerPath = outputDirectory.filePath(modelInfo.completeBaseName() + ".h");
+    jobs[i].className = toIdentifier(modelInfo.completeBaseName());
+
+    if (settings.writeBinary && (modelInfo.suffix() != "nnm"))
+      jobs[i].binaryPath = outputDirectory.filePath(modelInfo.completeBaseName() + ".nnm");
+
+    if (calibrate)
+      jobs[i].quantizedPath = outputDirectory.filePath(modelInfo.completeBaseName() + ".qparams");
+  }
+
+  const auto start = std::chrono::steady_clock::now();
+
+  {
+    ThreadPool pool(static_cast<std::size_t>(threadCount));
+
+    for (auto& job : jobs)
+      pool.submit([&job, &settings]() { runJob(job, settings); });
+
+    pool.wait();
+  }
+
+  const double totalSeconds = secondsSince(start);
+
+  int failureCount = 0;
+
+  std::printf("%10s %10s %10s %10s  %s\n", "exprs", "load ms", "compile ms", "codegen ms", "model");
+
+  for (const auto& job : jobs) {
+
+    if (!job.error.isEmpty()) {
+      std::fprintf(stderr, "%s: %s\n", qPrintable(job.modelPath), qPrintable(job.error));
+      failureCount++;
+      continue;
+    }
+
+    std::printf("%10zu %10.3f %10.3f %10.3f  %s -> %s\n",
+                job.exprCount,
+                job.loadSeconds * 1e3,
+                job.compileSeconds * 1e3,
+                job.generateSeconds * 1e3,
+                qPrintable(job.modelPath),
+                qPrintable(job.headerPath));
+
+    if (!job.quantizedPath.isEmpty()) {
+      std::printf("%43s  quantized with %.2f%% max, %.2f%% mean error -> %s\n",
+                  "",
+                  job.quantizationError.maxError * 100.0,
+                  job.quantizationError.meanError * 100.0,
+                  qPrintable(job.quantizedPath));
+    }
+  }
+
+  std::printf("%d of %d models generated in %.3f ms\n",
+              static_cast<int>(jobs.size()) - failureCount,
+              static_cast<int>(jobs.size()),
+              totalSeconds * 1e3);
+
+  return (failureCount == 0) ? 0 : 1;
+}
@@ -1,22 +1,92 @@
 #include "node.h"
 
+#include <cstdint>
+
+namespace {
+
+/// @brief The number of connections at which looking them up switches from a linear search to the hash table.
+constexpr int g_minHashedConnections = 16;
+
+auto
+hashNode(const Node* node, std::size_t mask) -> std::size_t
+{
+  /* Nodes are heap allocated, so the low bits of their addresses carry little information. */
+
+  const auto address = static_cast<std::uint64_t>(reinterpret_cast<std::uintptr_t>(node));
+
+  return static_cast<std::size_t>(((address >> 4) * 0x9e3779b97f4a7c15ull) >> 32) & mask;
+}
+
+} // namespace
+
 auto
 Node::addConnection(std::shared_ptr<Node> node) -> bool
 {
-  if ((node.get() != this) && !connected(node.get())) {
-    m_connections.emplace_back(std::move(node));
-    return true;
+  if ((node.get() == this) || connected(node.get()))
+    return false;
+
+  if (!m_connectionTable.empty()) {
+
+    if ((static_cast<std::size_t>(m_connections.size()) + 1) * 2 > m_connectionTable.size())
+      growTable();
+
+    insertIntoTable(node.get());
   }
 
-  return false;
+  m_connections.emplace_back(std::move(node));
+
+  if ((m_connections.size() == g_minHashedConnections) && m_connectionTable.empty())
+    growTable();
+
+  return true;
 }
 
 auto
 Node::connected(const Node* node) const -> bool
 {
-  for (const auto& n : m_connections) {
-    if (n.get() == node)
+  if (m_connectionTable.empty()) {
+    for (const auto& n : m_connections) {
+      if (n.get() == node)
+        return true;
+    }
+    return false;
+  }
+
+  const auto mask = m_connectionTable.size() - 1;
+
+  for (auto i = hashNode(node, mask);; i = (i + 1) & mask) {
+    if (m_connectionTable[i] == node)
       return true;
+    else if (!m_connectionTable[i])
+      return false;
   }
-  return false;
+}
+
+void
+Node::insertIntoTable(const Node* node)
+{
+  const auto mask = m_connectionTable.size() - 1;
+
+  auto i = hashNode(node, mask);
+
+  while (m_connectionTable[i])
+    i = (i + 1) & mask;
+
+  m_connectionTable[i] = node;
+}
+
+void
+Node::growTable()
+{
+  /* The size stays a power of two, so that a mask can be used in place of a modulo. */
+
+  std::size_t size = m_connectionTable.empty() ? (g_minHashedConnections * 4) : (m_connectionTable.size() * 2);
+
+  while (size < static_cast<std::size_t>(m_connections.size()) * 2)
+    size *= 2;
+
+  m_connectionTable.assign(size, nullptr);
+
+  for (const auto& connection : m_connections)
+    insertIntoTable(connection.get());
 }
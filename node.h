@@ -7,12 +7,31 @@
 #include <QVector>
 
 #include <memory>
+#include <vector>
 
-class Node final : public Component
+enum class NodeKind
+{
+  Input,
+  Hidden,
+  Output
+};
+
+/// @brief A node of a model. Nodes are always owned through shared pointers, which lets views that only keep raw
+///        pointers get back to the owning one.
+class Node final
+  : public Component
+  , public std::enable_shared_from_this<Node>
 {
 public:
   using NodeVector = QVector<std::shared_ptr<Node>>;
 
+  explicit Node(NodeKind kind)
+    : m_kind(kind)
+  {}
+
+  /// @brief Gets the kind of the node, which decides which of the model's node lists it belongs to.
+  auto getKind() const noexcept -> NodeKind { return m_kind; }
+
   /// @brief Adds a connected node, if it isn't already connected.
   ///
   /// @return True if the node was connected, false if it was not.
@@ -24,11 +43,26 @@ public:
 
   void setPosition(const QVector2D& p) { m_position = p; }
 
+  /// @brief Checks whether a node is connected, in constant time.
   auto connected(const Node* node) const -> bool;
 
+private:
+  /// @brief Adds a node to @ref m_connectionTable, which is assumed to have room for it.
+  void insertIntoTable(const Node* node);
+
+  void growTable();
+
 private:
   NodeVector m_connections;
 
+  /// @brief An open addressing hash table of the connected nodes, for looking them up once there are many.
+  ///
+  /// @detail It stays empty until the node has enough connections that a linear search would be slower than hashing,
+  ///         and from then on is kept at most half full. Connections are never removed, so no tombstones are needed.
+  std::vector<const Node*> m_connectionTable;
+
+  NodeKind m_kind;
+
   QVector2D m_position{ 0, 0 };
 };
 
@@ -0,0 +1,141 @@
+#include "nodegrid.h"
+
+#include "node.h"
+
+#include <algorithm>
+#include <cmath>
+
+NodeGrid::NodeGrid(float cellSize)
+  : m_cellSize(cellSize)
+{}
+
+void
+NodeGrid::insert(Node* node)
+{
+  const auto key = getCellKey(node->getPosition());
+
+  if (!m_nodeCells.emplace(node, key).second)
+    return;
+
+  m_cells[key].emplace_back(node);
+}
+
+void
+NodeGrid::remove(const Node* node)
+{
+  const auto it = m_nodeCells.find(node);
+
+  if (it == m_nodeCells.end())
+    return;
+
+  removeFromCell(it->second, node);
+
+  m_nodeCells.erase(it);
+}
+
+void
+NodeGrid::update(Node* node)
+{
+  const auto it = m_nodeCells.find(node);
+
+  if (it == m_nodeCells.end())
+    return;
+
+  const auto key = getCellKey(node->getPosition());
+
+  /* While a node is dragged, most moves stay within its cell. */
+
+  if (key == it->second)
+    return;
+
+  removeFromCell(it->second, node);
+
+  it->second = key;
+
+  m_cells[key].emplace_back(node);
+}
+
+void
+NodeGrid::clear()
+{
+  m_cells.clear();
+
+  m_nodeCells.clear();
+}
+
+auto
+NodeGrid::findNearest(const QVector2D& point, float radius) const -> Node*
+{
+  const auto xMin = getCellCoordinate(point.x() - radius);
+  const auto xMax = getCellCoordinate(point.x() + radius);
+  const auto yMin = getCellCoordinate(point.y() - radius);
+  const auto yMax = getCellCoordinate(point.y() + radius);
+
+  Node* nearestNode = nullptr;
+
+  float nearestDistance = radius * radius;
+
+  for (auto y = yMin; y <= yMax; y++) {
+
+    for (auto x = xMin; x <= xMax; x++) {
+
+      const auto it = m_cells.find(getCellKey(x, y));
+
+      if (it == m_cells.end())
+        continue;
+
+      for (auto* node : it->second) {
+
+        const auto delta = point - node->getPosition();
+
+        const auto distance = QVector2D::dotProduct(delta, delta);
+
+        if (distance < nearestDistance) {
+          nearestDistance = distance;
+          nearestNode = node;
+        }
+      }
+    }
+  }
+
+  return nearestNode;
+}
+
+auto
+NodeGrid::getCellCoordinate(float x) const -> std::int32_t
+{
+  /* Positions far outside of the canvas end up in the outermost cells, rather than overflowing. */
+
+  constexpr float limit = 1 << 30;
+
+  return static_cast<std::int32_t>(std::floor(std::min(std::max(x / m_cellSize, -limit), limit)));
+}
+
+auto
+NodeGrid::getCellKey(const QVector2D& position) const -> CellKey
+{
+  return getCellKey(getCellCoordinate(position.x()), getCellCoordinate(position.y()));
+}
+
+auto
+NodeGrid::getCellKey(std::int32_t x, std::int32_t y) -> CellKey
+{
+  return (static_cast<CellKey>(static_cast<std::uint32_t>(x)) << 32) | static_cast<std::uint32_t>(y);
+}
+
+void
+NodeGrid::removeFromCell(CellKey key, const Node* node)
+{
+  const auto cell = m_cells.find(key);
+
+  auto& nodes = cell->second;
+
+  const auto it = std::find(nodes.begin(), nodes.end(), node);
+
+  *it = nodes.back();
+
+  nodes.pop_back();
+
+  if (nodes.empty())
+    m_cells.erase(cell);
+}
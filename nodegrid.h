@@ -0,0 +1,57 @@
+#pragma once
+
+#include <QVector2D>
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+class Node;
+
+/// @brief A uniform grid over the positions of nodes, for finding the node under a point without looking at all of
+///        them.
+///
+/// @detail Each node is kept in the cell that contains its position, and the cells are stored in a hash table, so
+///         only the occupied ones take up memory and the canvas has no bounds. Looking up a point only visits the
+///         cells within the search radius of it, which is a small constant number of cells when the radius is no
+///         larger than a cell.
+///
+///         The grid doesn't observe the nodes. Whoever moves a node has to call @ref update afterwards.
+class NodeGrid final
+{
+public:
+  explicit NodeGrid(float cellSize);
+
+  void insert(Node* node);
+
+  void remove(const Node* node);
+
+  /// @brief Moves a node to the cell of its current position, if it has left the cell it was in.
+  void update(Node* node);
+
+  void clear();
+
+  /// @brief Finds the node closest to a point, among those within a radius of it.
+  ///
+  /// @return The node, or null if there is none within the radius.
+  auto findNearest(const QVector2D& point, float radius) const -> Node*;
+
+private:
+  using CellKey = std::uint64_t;
+
+  auto getCellCoordinate(float x) const -> std::int32_t;
+
+  auto getCellKey(const QVector2D& position) const -> CellKey;
+
+  static auto getCellKey(std::int32_t x, std::int32_t y) -> CellKey;
+
+  void removeFromCell(CellKey key, const Node* node);
+
+private:
+  float m_cellSize;
+
+  std::unordered_map<CellKey, std::vector<Node*>> m_cells;
+
+  /// @brief The cell that each node was put into, which may no longer be the one of its position until it is updated.
+  std::unordered_map<const Node*, CellKey> m_nodeCells;
+};
@@ -0,0 +1,390 @@
+#include "optimizer.h"
+
+namespace {
+
+/// @brief Marks an instruction that is removed without anything using its result.
+constexpr std::uint32_t g_removed = 0xffffffff;
+
+/// @brief Appends a copy of an instruction to another program.
+///
+/// @param remap Maps an instruction of the source program to the instruction of the destination program that holds
+///              its result.
+///
+/// @param operands Scratch space, to avoid allocating for each instruction.
+template<typename Remap>
+auto
+copyExpr(const Program& program, std::uint32_t exprIndex, Program& result, std::vector<std::uint32_t>& operands,
+         Remap remap) -> std::uint32_t
+{
+  const std::uint32_t* oldOperands = program.getOperands(exprIndex);
+
+  operands.assign(oldOperands, oldOperands + program.getOperandCount(exprIndex));
+
+  const OperandRange range = program.getExprOperandRange(exprIndex);
+
+  for (std::uint32_t j = range.first; j < (range.first + range.count); j++)
+    operands[j] = remap(operands[j]);
+
+  return result.append(program.getOpcode(exprIndex), operands.data(), operands.size());
+}
+
+/// @brief Counts the uses of each instruction's result, including its uses as an output.
+auto
+countUses(const Program& program) -> std::vector<std::uint32_t>
+{
+  std::vector<std::uint32_t> useCounts(program.size(), 0);
+
+  for (std::uint32_t i = 0; i < program.size(); i++) {
+
+    const std::uint32_t* operands = program.getOperands(i);
+
+    const OperandRange range = program.getExprOperandRange(i);
+
+    for (std::uint32_t j = range.first; j < (range.first + range.count); j++)
+      useCounts[operands[j]]++;
+  }
+
+  for (const auto outputExpr : program.getOutputExprIndices())
+    useCounts[outputExpr]++;
+
+  return useCounts;
+}
+
+/// @brief Builds a copy of a program without the instructions that a pass has replaced or removed.
+///
+/// @param replacements For each instruction, the instruction that takes its place. This is either the instruction
+///                     itself, which keeps it, an earlier instruction that is kept, or @ref g_removed.
+///
+/// @return The number of instructions that were left out.
+auto
+rebuild(Program& program, const std::vector<std::uint32_t>& replacements) -> std::size_t
+{
+  const auto exprCount = static_cast<std::uint32_t>(program.size());
+
+  std::vector<std::uint32_t> newIndices(exprCount, g_removed);
+
+  std::size_t keptCount = 0;
+
+  std::size_t operandCount = 0;
+
+  for (std::uint32_t i = 0; i < exprCount; i++) {
+    if (replacements[i] == i) {
+      keptCount++;
+      operandCount += program.getOperandCount(i);
+    }
+  }
+
+  if (keptCount == exprCount)
+    return 0;
+
+  Program result;
+
+  result.reserve(keptCount, operandCount, program.getOutputExprIndices().size());
+  result.setInputCount(program.getInputCount());
+  result.setParameterLayout(program.getParameterLayout());
+
+  std::vector<std::uint32_t> operands;
+
+  for (std::uint32_t i = 0; i < exprCount; i++) {
+
+    if (replacements[i] != i)
+      continue;
+
+    newIndices[i] = copyExpr(program, i, result, operands, [&](std::uint32_t operand) {
+      return newIndices[replacements[operand]];
+    });
+  }
+
+  for (const auto outputExpr : program.getOutputExprIndices())
+    result.addOutput(newIndices[replacements[outputExpr]]);
+
+  program = std::move(result);
+
+  return exprCount - keptCount;
+}
+
+/// @brief Creates a replacement table that keeps every instruction.
+auto
+makeIdentity(const Program& program) -> std::vector<std::uint32_t>
+{
+  std::vector<std::uint32_t> replacements(program.size());
+
+  for (std::uint32_t i = 0; i < replacements.size(); i++)
+    replacements[i] = i;
+
+  return replacements;
+}
+
+} // namespace
+
+auto
+foldAddZero(Program& program) -> std::size_t
+{
+  auto replacements = makeIdentity(program);
+
+  auto isZero = [&](std::uint32_t exprIndex) { return program.getOpcode(replacements[exprIndex]) == Opcode::Zero; };
+
+  for (std::uint32_t i = 0; i < replacements.size(); i++) {
+
+    if (program.getOpcode(i) != Opcode::Add)
+      continue;
+
+    const std::uint32_t* operands = program.getOperands(i);
+
+    if (isZero(operands[0]))
+      replacements[i] = replacements[operands[1]];
+    else if (isZero(operands[1]))
+      replacements[i] = replacements[operands[0]];
+  }
+
+  return rebuild(program, replacements);
+}
+
+auto
+deduplicateLoads(Program& program) -> std::size_t
+{
+  /* Indices are dense, so the first load of each index is found with a table rather than a hash map. */
+
+  std::vector<std::uint32_t> firstInputs(program.getInputCount(), g_removed);
+
+  std::vector<std::uint32_t> firstParameters(program.getParameterCount(), g_removed);
+
+  std::uint32_t firstZero = g_removed;
+
+  auto replacements = makeIdentity(program);
+
+  auto merge = [&replacements](std::uint32_t& first, std::uint32_t exprIndex) {
+    if (first == g_removed)
+      first = exprIndex;
+    else
+      replacements[exprIndex] = first;
+  };
+
+  for (std::uint32_t i = 0; i < replacements.size(); i++) {
+
+    switch (program.getOpcode(i)) {
+      case Opcode::Zero:
+        merge(firstZero, i);
+        break;
+      case Opcode::Input:
+        if (program.getOperands(i)[0] < firstInputs.size())
+          merge(firstInputs[program.getOperands(i)[0]], i);
+        break;
+      case Opcode::Weight:
+      case Opcode::Bias:
+        if (program.getOperands(i)[0] < firstParameters.size())
+          merge(firstParameters[program.getOperands(i)[0]], i);
+        break;
+      default:
+        break;
+    }
+  }
+
+  return rebuild(program, replacements);
+}
+
+auto
+eliminateDeadCode(Program& program) -> std::size_t
+{
+  /* Every operand refers to an earlier instruction, so one backwards sweep finds everything that is reachable. */
+
+  std::vector<bool> live(program.size(), false);
+
+  for (const auto outputExpr : program.getOutputExprIndices())
+    live[outputExpr] = true;
+
+  for (auto i = static_cast<std::uint32_t>(program.size()); i-- > 0;) {
+
+    if (!live[i])
+      continue;
+
+    const std::uint32_t* operands = program.getOperands(i);
+
+    const OperandRange range = program.getExprOperandRange(i);
+
+    for (std::uint32_t j = range.first; j < (range.first + range.count); j++)
+      live[operands[j]] = true;
+  }
+
+  auto replacements = makeIdentity(program);
+
+  for (std::uint32_t i = 0; i < replacements.size(); i++) {
+    if (!live[i])
+      replacements[i] = g_removed;
+  }
+
+  return rebuild(program, replacements);
+}
+
+auto
+formDotProducts(Program& program) -> std::size_t
+{
+  /* The roots are the sums fed into activations. A chain is only reduced when every add and multiply-add in it is
+   * used by the chain alone, and when its weights and biases are consecutive, in the order of the chain. */
+
+  const auto exprCount = static_cast<std::uint32_t>(program.size());
+
+  const auto useCounts = countUses(program);
+
+  /* The multiply-adds of each reduced chain are stored as a run in one array, and each root records where its run
+   * starts and how long it is. */
+
+  std::vector<bool> removed(exprCount, false);
+
+  std::vector<std::uint32_t> rootTerms(exprCount, g_removed);
+
+  std::vector<std::uint32_t> rootTermCounts(exprCount, 0);
+
+  std::vector<std::uint32_t> terms;
+
+  std::vector<std::uint32_t> chain;
+
+  std::vector<std::uint32_t> pending;
+
+  auto getParameterIndex = [&program](std::uint32_t loadExpr) { return program.getOperands(loadExpr)[0]; };
+
+  std::size_t removedCount = 0;
+
+  std::size_t operandCount = 0;
+
+  for (std::uint32_t i = 0; i < exprCount; i++) {
+
+    operandCount += program.getOperandCount(i);
+
+    if (program.getOpcode(i) != Opcode::Activation)
+      continue;
+
+    const std::uint32_t root = program.getOperands(i)[0];
+
+    if ((program.getOpcode(root) != Opcode::Add) || (rootTerms[root] != g_removed))
+      continue;
+
+    const auto firstTerm = static_cast<std::uint32_t>(terms.size());
+
+    chain.clear();
+
+    pending.assign(1, root);
+
+    bool reducible = true;
+
+    /* Walk the chain left to right, so that the terms come out in the order they were lowered in. */
+
+    while (reducible && !pending.empty()) {
+
+      const std::uint32_t exprIndex = pending.back();
+
+      pending.pop_back();
+
+      if ((exprIndex != root) && (useCounts[exprIndex] != 1) && (program.getOpcode(exprIndex) != Opcode::Zero)) {
+        reducible = false;
+        break;
+      }
+
+      const std::uint32_t* operands = program.getOperands(exprIndex);
+
+      switch (program.getOpcode(exprIndex)) {
+        case Opcode::Zero:
+          break;
+        case Opcode::Add:
+          chain.emplace_back(exprIndex);
+          pending.emplace_back(operands[1]);
+          pending.emplace_back(operands[0]);
+          break;
+        case Opcode::MultiplyAdd:
+          chain.emplace_back(exprIndex);
+          terms.emplace_back(exprIndex);
+          break;
+        default:
+          reducible = false;
+          break;
+      }
+    }
+
+    const auto termCount = static_cast<std::uint32_t>(terms.size()) - firstTerm;
+
+    for (std::uint32_t t = 0; reducible && (t < termCount); t++) {
+
+      const std::uint32_t* first = program.getOperands(terms[firstTerm]);
+      const std::uint32_t* term = program.getOperands(terms[firstTerm + t]);
+
+      reducible = (program.getOpcode(term[1]) == Opcode::Bias) && (program.getOpcode(term[2]) == Opcode::Weight) &&
+                  (getParameterIndex(term[1]) == (getParameterIndex(first[1]) + t)) &&
+                  (getParameterIndex(term[2]) == (getParameterIndex(first[2]) + t));
+    }
+
+    if (!reducible || (termCount < 2)) {
+      terms.resize(firstTerm);
+      continue;
+    }
+
+    for (const auto exprIndex : chain)
+      removed[exprIndex] = true;
+
+    rootTerms[root] = firstTerm;
+    rootTermCounts[root] = termCount;
+
+    /* The chain is replaced by a single instruction. */
+    removedCount += chain.size() - 1;
+    operandCount += DotExpr::operandCount(termCount);
+  }
+
+  if (removedCount == 0)
+    return 0;
+
+  Program result;
+
+  result.reserve(exprCount - removedCount, operandCount, program.getOutputExprIndices().size());
+  result.setInputCount(program.getInputCount());
+  result.setParameterLayout(program.getParameterLayout());
+
+  std::vector<std::uint32_t> newIndices(exprCount, g_removed);
+
+  std::vector<std::uint32_t> operands;
+
+  for (std::uint32_t i = 0; i < exprCount; i++) {
+
+    if (rootTerms[i] != g_removed) {
+
+      const std::uint32_t termCount = rootTermCounts[i];
+
+      const std::uint32_t* first = program.getOperands(terms[rootTerms[i]]);
+
+      operands.assign({ termCount, getParameterIndex(first[2]), getParameterIndex(first[1]) });
+
+      for (std::uint32_t t = 0; t < termCount; t++)
+        operands.emplace_back(newIndices[program.getOperands(terms[rootTerms[i] + t])[0]]);
+
+      newIndices[i] = result.append(Opcode::Dot, operands.data(), operands.size());
+
+      continue;
+    }
+
+    if (removed[i])
+      continue;
+
+    newIndices[i] = copyExpr(program, i, result, operands, [&](std::uint32_t operand) { return newIndices[operand]; });
+  }
+
+  for (const auto outputExpr : program.getOutputExprIndices())
+    result.addOutput(newIndices[outputExpr]);
+
+  program = std::move(result);
+
+  return removedCount;
+}
+
+auto
+optimize(Program& program) -> std::vector<PassReport>
+{
+  std::vector<PassReport> reports;
+
+  reports.push_back(PassReport{ "fold-add-zero", foldAddZero(program) });
+
+  reports.push_back(PassReport{ "deduplicate-loads", deduplicateLoads(program) });
+
+  reports.push_back(PassReport{ "form-dot-products", formDotProducts(program) });
+
+  reports.push_back(PassReport{ "eliminate-dead-code", eliminateDeadCode(program) });
+
+  return reports;
+}
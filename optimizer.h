@@ -0,0 +1,48 @@
+#pragma once
+
+#include "ir.h"
+
+#include <vector>
+
+#include <cstddef>
+
+/// @brief The outcome of running one optimization pass.
+struct PassReport final
+{
+  /// @brief The name of the pass, as shown to the user.
+  const char* name;
+
+  /// @brief The number of instructions that the pass removed.
+  std::size_t removedCount;
+};
+
+/// @brief Replaces each <tt>add zero x</tt> (or <tt>add x zero</tt>) with @e x.
+///
+/// @return The number of additions removed.
+auto
+foldAddZero(Program& program) -> std::size_t;
+
+/// @brief Merges loads of the same input, weight or bias, as well as zeros, into the first of them.
+///
+/// @return The number of loads removed.
+auto
+deduplicateLoads(Program& program) -> std::size_t;
+
+/// @brief Replaces each node's chain of multiply-adds and adds with a single @ref DotExpr.
+///
+/// @detail The multiply-adds and adds of the chains are removed. The loads they used are left to
+///         @ref eliminateDeadCode.
+///
+/// @return The number of instructions removed, net of the dot products added.
+auto
+formDotProducts(Program& program) -> std::size_t;
+
+/// @brief Removes the instructions whose results do not contribute to any output of the program.
+///
+/// @return The number of instructions removed.
+auto
+eliminateDeadCode(Program& program) -> std::size_t;
+
+/// @brief Runs all of the passes above, in an order where each one leaves work for the next.
+auto
+optimize(Program& program) -> std::vector<PassReport>;
@@ -0,0 +1,444 @@
+#include "quantizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+/// @brief The number of samples evaluated per call to the interpreter during calibration.
+constexpr std::size_t g_calibrationChunkSize = 256;
+
+/// @brief The largest magnitude of a quantized value. The range is kept symmetric, so -128 is not used.
+constexpr float g_valueLimit = 127.0f;
+
+/// @brief One product accumulated by a node.
+struct Term final
+{
+  std::uint32_t weightIndex;
+
+  std::uint32_t biasIndex;
+
+  std::uint32_t inputExpr;
+};
+
+/// @brief Splits a real multiplier into a 31-bit fixed point multiplier and a right shift.
+void
+splitMultiplier(double real, std::int32_t& multiplier, std::int32_t& shift)
+{
+  multiplier = 0;
+  shift = 0;
+
+  if (!(real > 0.0))
+    return;
+
+  int exponent = 0;
+
+  const double mantissa = std::frexp(real, &exponent);
+
+  long long fixed = std::llround(mantissa * 2147483648.0);
+
+  if (fixed == 2147483648LL) {
+    fixed /= 2;
+    exponent++;
+  }
+
+  const int rightShift = 31 - exponent;
+
+  if (rightShift > 62)
+    return;
+
+  if (rightShift < 0) {
+    multiplier = std::numeric_limits<std::int32_t>::max();
+    return;
+  }
+
+  multiplier = static_cast<std::int32_t>(fixed);
+  shift = rightShift;
+}
+
+template<typename Int>
+auto
+roundSaturate(double value) -> Int
+{
+  const double lo = static_cast<double>(std::numeric_limits<Int>::min());
+  const double hi = static_cast<double>(std::numeric_limits<Int>::max());
+
+  return static_cast<Int>(std::min(std::max(std::round(value), lo), hi));
+}
+
+/// @brief Takes an accumulator to the scale of a node's output, the way the generated code does.
+auto
+requantize(std::int32_t value, std::int32_t multiplier, std::int32_t shift) -> std::int32_t
+{
+  const std::int64_t rounding = (shift > 0) ? (std::int64_t(1) << (shift - 1)) : 0;
+
+  const std::int64_t scaled = ((std::int64_t(value) * multiplier) + rounding) >> shift;
+
+  const std::int64_t lo = std::numeric_limits<std::int32_t>::min();
+  const std::int64_t hi = std::numeric_limits<std::int32_t>::max();
+
+  return static_cast<std::int32_t>(std::min(std::max(scaled, lo), hi));
+}
+
+} // namespace
+
+Quantizer::Quantizer(const Program& program)
+  : m_program(program)
+  , m_exprLevels(program.size())
+{
+  std::uint32_t maxLevel = 0;
+
+  for (std::uint32_t i = 0; i < program.size(); i++) {
+
+    const std::uint32_t* operands = program.getOperands(i);
+
+    std::uint32_t level = 0;
+
+    switch (program.getOpcode(i)) {
+      case Opcode::Zero:
+      case Opcode::Input:
+      case Opcode::Weight:
+      case Opcode::Bias:
+        break;
+      case Opcode::Add:
+        level = std::max(m_exprLevels[operands[0]], m_exprLevels[operands[1]]);
+        break;
+      case Opcode::MultiplyAdd:
+        level = m_exprLevels[operands[0]];
+        break;
+      case Opcode::MatVec:
+        for (std::uint32_t j = 0; j < operands[1]; j++)
+          level = std::max(level, m_exprLevels[operands[4 + j]]);
+        break;
+      case Opcode::Element:
+        level = m_exprLevels[operands[0]];
+        break;
+      case Opcode::Dot:
+        for (std::uint32_t j = 0; j < operands[0]; j++)
+          level = std::max(level, m_exprLevels[operands[3 + j]]);
+        break;
+      case Opcode::Activation:
+        level = m_exprLevels[operands[0]] + 1;
+        maxLevel = std::max(maxLevel, level);
+        m_activationExprs.emplace_back(i);
+        break;
+    }
+
+    m_exprLevels[i] = level;
+  }
+
+  m_levelRanges.resize(maxLevel + 1, 0.0f);
+}
+
+void
+Quantizer::calibrate(const float* parameters, const float* inputs, std::size_t sampleCount)
+{
+  const std::size_t inputCount = m_program.getInputCount();
+
+  for (std::size_t i = 0; i < (inputCount * sampleCount); i++)
+    m_levelRanges[0] = std::max(m_levelRanges[0], std::fabs(inputs[i]));
+
+  if (m_activationExprs.empty())
+    return;
+
+  /* The interpreter only exposes the outputs of a program, so a copy is made which also outputs every activation. */
+
+  Program probe = m_program;
+
+  const std::size_t firstProbe = probe.getOutputExprIndices().size();
+
+  for (const auto activationExpr : m_activationExprs)
+    probe.addOutput(activationExpr);
+
+  const std::size_t outputCount = probe.getOutputExprIndices().size();
+
+  Interpreter interpreter(probe);
+
+  interpreter.setActivation(m_activation);
+
+  std::vector<float> outputs(g_calibrationChunkSize * outputCount);
+
+  for (std::size_t first = 0; first < sampleCount; first += g_calibrationChunkSize) {
+
+    const std::size_t count = std::min(g_calibrationChunkSize, sampleCount - first);
+
+    interpreter.run(parameters, inputs + (first * inputCount), count, outputs.data());
+
+    for (std::size_t i = 0; i < count; i++) {
+
+      const float* sampleOutputs = outputs.data() + (i * outputCount);
+
+      for (std::size_t j = 0; j < m_activationExprs.size(); j++) {
+        float& range = m_levelRanges[m_exprLevels[m_activationExprs[j]]];
+        range = std::max(range, std::fabs(sampleOutputs[firstProbe + j]));
+      }
+    }
+  }
+}
+
+auto
+Quantizer::quantize(const float* parameters) const -> QuantizedParameters
+{
+  const ParameterLayout& layout = m_program.getParameterLayout();
+
+  QuantizedParameters result;
+
+  result.weights.resize(layout.weightCount, 0);
+  result.biases.resize(layout.biasCount, 0);
+  result.requantization.reserve(m_activationExprs.size() * 2);
+  result.inputScale = getLevelScale(0);
+
+  auto getValueScale = [this](std::uint32_t exprIndex) -> double {
+    return getLevelScale(m_exprLevels[exprIndex]);
+  };
+
+  std::vector<Term> terms;
+
+  std::vector<std::uint32_t> pending;
+
+  for (const auto activationExpr : m_activationExprs) {
+
+    /* Gather the products feeding the node, by walking its accumulation back to the products. */
+
+    terms.clear();
+
+    pending.assign(1, m_program.getOperands(activationExpr)[0]);
+
+    while (!pending.empty()) {
+
+      const std::uint32_t exprIndex = pending.back();
+
+      pending.pop_back();
+
+      const std::uint32_t* operands = m_program.getOperands(exprIndex);
+
+      switch (m_program.getOpcode(exprIndex)) {
+        case Opcode::Add:
+          pending.emplace_back(operands[0]);
+          pending.emplace_back(operands[1]);
+          break;
+        case Opcode::MultiplyAdd:
+          terms.push_back(
+            Term{ m_program.getOperands(operands[2])[0], m_program.getOperands(operands[1])[0], operands[0] });
+          break;
+        case Opcode::Element: {
+          const std::uint32_t* matVec = m_program.getOperands(operands[0]);
+          const std::uint32_t columnCount = matVec[1];
+          const std::uint32_t rowStart = operands[1] * columnCount;
+          for (std::uint32_t j = 0; j < columnCount; j++)
+            terms.push_back(Term{ matVec[2] + rowStart + j, matVec[3] + rowStart + j, matVec[4 + j] });
+        } break;
+        case Opcode::Dot:
+          for (std::uint32_t j = 0; j < operands[0]; j++)
+            terms.push_back(Term{ operands[1] + j, operands[2] + j, operands[3 + j] });
+          break;
+        default:
+          break;
+      }
+    }
+
+    const double outputScale = getValueScale(activationExpr);
+
+    double accumulatorScale = 0.0;
+
+    for (const auto& term : terms) {
+      const double product = std::fabs(parameters[term.weightIndex]) * getValueScale(term.inputExpr);
+      accumulatorScale = std::max(accumulatorScale, product);
+    }
+
+    accumulatorScale = (accumulatorScale > 0.0) ? (accumulatorScale / g_valueLimit) : outputScale;
+
+    for (const auto& term : terms) {
+
+      const double weight = parameters[term.weightIndex] * getValueScale(term.inputExpr) / accumulatorScale;
+
+      result.weights[term.weightIndex - layout.weightOffset] = roundSaturate<std::int8_t>(weight);
+
+      result.biases[term.biasIndex - layout.biasOffset] =
+        roundSaturate<std::int32_t>(parameters[term.biasIndex] / accumulatorScale);
+    }
+
+    std::int32_t multiplier = 0;
+    std::int32_t shift = 0;
+
+    splitMultiplier(accumulatorScale / outputScale, multiplier, shift);
+
+    result.requantization.emplace_back(multiplier);
+    result.requantization.emplace_back(shift);
+  }
+
+  for (const auto outputExpr : m_program.getOutputExprIndices())
+    result.outputScales.emplace_back(static_cast<float>(getValueScale(outputExpr)));
+
+  return result;
+}
+
+void
+Quantizer::evaluate(const QuantizedParameters& parameters,
+                    const float* inputs,
+                    std::size_t sampleCount,
+                    float* outputs) const
+{
+  const ParameterLayout& layout = m_program.getParameterLayout();
+
+  const std::size_t inputCount = m_program.getInputCount();
+
+  const auto& outputExprs = m_program.getOutputExprIndices();
+
+  /* Each instruction has as many values as its result, which is more than one for matrix-vector products. Sums are
+   * kept in 32 bits, as in the generated code. */
+
+  std::vector<std::uint32_t> valueOffsets(m_program.size());
+
+  std::uint32_t valueCount = 0;
+
+  for (std::uint32_t i = 0; i < m_program.size(); i++) {
+    valueOffsets[i] = valueCount;
+    valueCount += m_program.getResultSize(i);
+  }
+
+  std::vector<std::int32_t> values(valueCount);
+
+  auto value = [&values, &valueOffsets](std::uint32_t exprIndex) -> std::int32_t {
+    return values[valueOffsets[exprIndex]];
+  };
+
+  auto product = [&parameters, &layout](std::int32_t input, std::uint32_t weightIndex, std::uint32_t biasIndex) {
+    return (input * std::int32_t(parameters.weights[weightIndex - layout.weightOffset])) +
+           parameters.biases[biasIndex - layout.biasOffset];
+  };
+
+  for (std::size_t sample = 0; sample < sampleCount; sample++) {
+
+    const float* sampleInputs = inputs + (sample * inputCount);
+
+    std::size_t activationIndex = 0;
+
+    for (std::uint32_t i = 0; i < m_program.size(); i++) {
+
+      const std::uint32_t* operands = m_program.getOperands(i);
+
+      std::int32_t* result = values.data() + valueOffsets[i];
+
+      switch (m_program.getOpcode(i)) {
+        case Opcode::Zero:
+        case Opcode::Weight:
+        case Opcode::Bias:
+          /* Parameters are only read by the instructions that use them. */
+          *result = 0;
+          break;
+        case Opcode::Input:
+          *result = roundSaturate<std::int8_t>(sampleInputs[operands[0]] / parameters.inputScale);
+          break;
+        case Opcode::Add:
+          *result = value(operands[0]) + value(operands[1]);
+          break;
+        case Opcode::MultiplyAdd: {
+          const std::uint32_t weightIndex = m_program.getOperands(operands[2])[0];
+          const std::uint32_t biasIndex = m_program.getOperands(operands[1])[0];
+          *result = product(value(operands[0]), weightIndex, biasIndex);
+        } break;
+        case Opcode::MatVec:
+          for (std::uint32_t row = 0; row < operands[0]; row++) {
+            std::int32_t sum = 0;
+            for (std::uint32_t j = 0; j < operands[1]; j++) {
+              const std::uint32_t k = (row * operands[1]) + j;
+              sum += product(value(operands[4 + j]), operands[2] + k, operands[3] + k);
+            }
+            result[row] = sum;
+          }
+          break;
+        case Opcode::Element:
+          *result = values[valueOffsets[operands[0]] + operands[1]];
+          break;
+        case Opcode::Dot: {
+          std::int32_t sum = 0;
+          for (std::uint32_t j = 0; j < operands[0]; j++)
+            sum += product(value(operands[3 + j]), operands[1] + j, operands[2] + j);
+          *result = sum;
+        } break;
+        case Opcode::Activation: {
+          const std::int32_t* pair = parameters.requantization.data() + (activationIndex * 2);
+          float activated = static_cast<float>(requantize(value(operands[0]), pair[0], pair[1]));
+          if (m_activation)
+            m_activation(&activated, 1);
+          *result = roundSaturate<std::int8_t>(activated);
+          activationIndex++;
+        } break;
+      }
+    }
+
+    float* sampleOutputs = outputs + (sample * outputExprs.size());
+
+    for (std::size_t j = 0; j < outputExprs.size(); j++)
+      sampleOutputs[j] = static_cast<float>(value(outputExprs[j])) * parameters.outputScales[j];
+  }
+}
+
+auto
+Quantizer::measureError(const float* parameters,
+                        const QuantizedParameters& quantized,
+                        const float* inputs,
+                        std::size_t sampleCount) const -> QuantizationError
+{
+  const std::size_t inputCount = m_program.getInputCount();
+
+  const std::size_t outputCount = m_program.getOutputExprIndices().size();
+
+  Interpreter interpreter(m_program);
+
+  interpreter.setActivation(m_activation);
+
+  std::vector<float> expected(g_calibrationChunkSize * outputCount);
+
+  std::vector<float> actual(g_calibrationChunkSize * outputCount);
+
+  std::vector<float> ranges(outputCount, 0.0f);
+
+  std::vector<float> maxErrors(outputCount, 0.0f);
+
+  std::vector<double> errorSums(outputCount, 0.0);
+
+  for (std::size_t first = 0; first < sampleCount; first += g_calibrationChunkSize) {
+
+    const std::size_t count = std::min(g_calibrationChunkSize, sampleCount - first);
+
+    interpreter.run(parameters, inputs + (first * inputCount), count, expected.data());
+
+    evaluate(quantized, inputs + (first * inputCount), count, actual.data());
+
+    for (std::size_t i = 0; i < (count * outputCount); i++) {
+      const std::size_t output = i % outputCount;
+      const float error = std::fabs(actual[i] - expected[i]);
+      ranges[output] = std::max(ranges[output], std::fabs(expected[i]));
+      maxErrors[output] = std::max(maxErrors[output], error);
+      errorSums[output] += error;
+    }
+  }
+
+  QuantizationError result;
+
+  if ((sampleCount == 0) || (outputCount == 0))
+    return result;
+
+  double meanError = 0.0;
+
+  for (std::size_t output = 0; output < outputCount; output++) {
+    const float range = (ranges[output] > 0.0f) ? ranges[output] : 1.0f;
+    result.maxError = std::max(result.maxError, maxErrors[output] / range);
+    meanError += errorSums[output] / range;
+  }
+
+  result.meanError = static_cast<float>(meanError / double(sampleCount * outputCount));
+
+  return result;
+}
+
+auto
+Quantizer::getLevelScale(std::size_t level) const -> float
+{
+  const float range = m_levelRanges[level];
+
+  return (range > 0.0f) ? (range / g_valueLimit) : 1.0f;
+}
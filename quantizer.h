@@ -0,0 +1,105 @@
+#pragma once
+
+#include "interpreter.h"
+#include "ir.h"
+
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+
+/// @brief The parameters of a program, converted for code generated with the quantized number format.
+///
+/// @detail Values are 8-bit integers. Each value produced by an activation has the scale of its level, which is the
+///         length of the longest path from the inputs to the node that produces it. The inputs are level zero.
+///
+///         The products feeding a node are accumulated in 32 bits. The weights of a node are quantized so that all of
+///         its products share one accumulator scale, even when its inputs come from different levels. Before the
+///         activation is applied, the accumulator is requantized to the scale of the node's level by multiplying it
+///         with a 31-bit fixed point multiplier and shifting it right.
+struct QuantizedParameters final
+{
+  /// @brief One weight per connection, in the order of the weights in the parameter layout.
+  std::vector<std::int8_t> weights;
+
+  /// @brief One bias per connection, in the accumulator scale of the node it feeds.
+  std::vector<std::int32_t> biases;
+
+  /// @brief For each activation, in program order, the fixed point multiplier followed by the right shift.
+  std::vector<std::int32_t> requantization;
+
+  /// @brief The real value of one step of a quantized input.
+  float inputScale = 1.0f;
+
+  /// @brief The real value of one step of each quantized output.
+  std::vector<float> outputScales;
+};
+
+/// @brief How far the outputs of a quantized program are from those of the floating point program.
+///
+/// @detail The differences are relative to the largest magnitude that each output took in floating point.
+struct QuantizationError final
+{
+  float maxError = 0.0f;
+
+  float meanError = 0.0f;
+};
+
+/// @brief Calibrates the value ranges of a program and quantizes its parameters to 8-bit integers.
+///
+/// @detail Calibration evaluates the floating point program with the interpreter over a set of sample inputs and
+///         records the largest magnitude seen at each level. It may be repeated with more samples before the
+///         parameters are quantized.
+class Quantizer final
+{
+public:
+  explicit Quantizer(const Program& program);
+
+  /// @brief Sets the activation function used during calibration. It should match the one used for training.
+  void setActivation(Interpreter::Activation activation) { m_activation = activation; }
+
+  /// @brief Evaluates a batch of samples and widens the range of each level to cover the values produced.
+  ///
+  /// @param parameters The floating point weights and biases, laid out as described by the program's parameter layout.
+  /// @param inputs The sample inputs, one sample after the other.
+  /// @param sampleCount The number of samples.
+  void calibrate(const float* parameters, const float* inputs, std::size_t sampleCount);
+
+  /// @brief Quantizes the parameters using the ranges found during calibration.
+  auto quantize(const float* parameters) const -> QuantizedParameters;
+
+  /// @brief Evaluates the quantized program with the same integer arithmetic as the generated code.
+  ///
+  /// @detail The activation function is applied to the requantized value of each node, converted to a float, which
+  ///         matches the generated code for scale invariant functions.
+  ///
+  /// @param inputs The real input values, one sample after the other. They are quantized with the input scale.
+  /// @param outputs Receives the real output values, one sample after the other.
+  void evaluate(const QuantizedParameters& parameters, const float* inputs, std::size_t sampleCount, float* outputs)
+    const;
+
+  /// @brief Compares the quantized program with the floating point program, evaluated by the interpreter.
+  auto measureError(const float* parameters,
+                    const QuantizedParameters& quantized,
+                    const float* inputs,
+                    std::size_t sampleCount) const -> QuantizationError;
+
+  auto getLevelCount() const noexcept -> std::size_t { return m_levelRanges.size(); }
+
+  /// @brief Gets the real value of one step of a quantized value at the given level.
+  auto getLevelScale(std::size_t level) const -> float;
+
+private:
+  const Program& m_program;
+
+  Interpreter::Activation m_activation = nullptr;
+
+  /// @brief The level of each instruction. For arithmetic, this is the level of the values flowing into it.
+  std::vector<std::uint32_t> m_exprLevels;
+
+  /// @brief The activations of the program, in program order.
+  std::vector<std::uint32_t> m_activationExprs;
+
+  /// @brief The largest magnitude seen at each level.
+  std::vector<float> m_levelRanges;
+};
@@ -0,0 +1,128 @@
+#include "regalloc.h"
+
+#include <algorithm>
+#include <map>
+
+constexpr std::uint32_t RegisterAllocation::noRegister;
+
+auto
+computeLastUses(const Program& program, const std::vector<bool>& hasRegister) -> std::vector<std::uint32_t>
+{
+  const auto exprCount = static_cast<std::uint32_t>(program.size());
+
+  std::vector<std::uint32_t> lastUses(exprCount);
+
+  for (std::uint32_t i = 0; i < exprCount; i++)
+    lastUses[i] = i;
+
+  for (const auto outputExpr : program.getOutputExprIndices())
+    lastUses[outputExpr] = exprCount;
+
+  /* Every user of an instruction comes after it, so by the time an instruction is reached in a backwards sweep, its
+   * own last use is known and can be passed on to its operands. */
+
+  for (auto i = exprCount; i-- > 0;) {
+
+    const bool isView = !hasRegister.empty() && !hasRegister[i];
+
+    const std::uint32_t use = isView ? lastUses[i] : i;
+
+    const std::uint32_t* operands = program.getOperands(i);
+
+    const OperandRange range = program.getExprOperandRange(i);
+
+    for (std::uint32_t j = range.first; j < (range.first + range.count); j++)
+      lastUses[operands[j]] = std::max(lastUses[operands[j]], use);
+  }
+
+  return lastUses;
+}
+
+RegisterAllocator::RegisterAllocator(const Program& program)
+  : m_program(program)
+{}
+
+auto
+RegisterAllocator::allocate() const -> RegisterAllocation
+{
+  const auto exprCount = static_cast<std::uint32_t>(m_program.size());
+
+  std::vector<std::uint32_t> classes(m_classes);
+
+  classes.resize(exprCount, 0);
+
+  std::vector<bool> hasRegister(exprCount, true);
+
+  for (std::uint32_t i = 0; i < exprCount; i++)
+    hasRegister[i] = classes[i] != RegisterAllocation::noRegister;
+
+  const auto lastUses = computeLastUses(m_program, hasRegister);
+
+  /* Group the instructions by the point after which their register is released, as a compressed table. */
+
+  std::vector<std::uint32_t> expiryOffsets(exprCount + 1, 0);
+
+  for (std::uint32_t i = 0; i < exprCount; i++) {
+    if (hasRegister[i] && (lastUses[i] < exprCount))
+      expiryOffsets[lastUses[i] + 1]++;
+  }
+
+  for (std::uint32_t i = 0; i < exprCount; i++)
+    expiryOffsets[i + 1] += expiryOffsets[i];
+
+  std::vector<std::uint32_t> expiring(expiryOffsets[exprCount]);
+
+  {
+    std::vector<std::uint32_t> cursors(expiryOffsets.begin(), expiryOffsets.end() - 1);
+
+    for (std::uint32_t i = 0; i < exprCount; i++) {
+      if (hasRegister[i] && (lastUses[i] < exprCount))
+        expiring[cursors[lastUses[i]]++] = i;
+    }
+  }
+
+  RegisterAllocation allocation;
+
+  allocation.exprSlots.assign(exprCount, RegisterAllocation::noRegister);
+
+  /* Keyed by class and size. Nearly every register holds one value, so there are only a handful of lists. */
+
+  std::map<std::pair<std::uint32_t, std::uint32_t>, std::vector<std::uint32_t>> freeLists;
+
+  std::uint32_t liveCount = 0;
+
+  for (std::uint32_t i = 0; i < exprCount; i++) {
+
+    if (hasRegister[i]) {
+
+      const std::uint32_t size = m_program.getResultSize(i);
+
+      auto& freeList = freeLists[std::make_pair(classes[i], size)];
+
+      if (freeList.empty()) {
+        allocation.exprSlots[i] = allocation.slotCount;
+        allocation.slotCount += size;
+      } else {
+        allocation.exprSlots[i] = freeList.back();
+        freeList.pop_back();
+      }
+
+      liveCount += size;
+
+      allocation.peakLiveCount = std::max(allocation.peakLiveCount, liveCount);
+    }
+
+    for (std::uint32_t j = expiryOffsets[i]; j < expiryOffsets[i + 1]; j++) {
+
+      const std::uint32_t exprIndex = expiring[j];
+
+      const std::uint32_t size = m_program.getResultSize(exprIndex);
+
+      freeLists[std::make_pair(classes[exprIndex], size)].emplace_back(allocation.exprSlots[exprIndex]);
+
+      liveCount -= size;
+    }
+  }
+
+  return allocation;
+}
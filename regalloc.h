@@ -0,0 +1,58 @@
+#pragma once
+
+#include "ir.h"
+
+#include <utility>
+#include <vector>
+
+#include <cstdint>
+
+/// @brief Where the result of each instruction of a program is kept.
+struct RegisterAllocation final
+{
+  /// @brief Marks an instruction whose result is not kept in a register.
+  static constexpr std::uint32_t noRegister = 0xffffffff;
+
+  /// @brief For each instruction, the first slot of its result, or @ref noRegister.
+  std::vector<std::uint32_t> exprSlots;
+
+  /// @brief The size of the register file, in values.
+  std::uint32_t slotCount = 0;
+
+  /// @brief The largest number of values that are live at the same time.
+  std::uint32_t peakLiveCount = 0;
+};
+
+/// @brief Computes, for each instruction, the index of the last instruction that reads its result.
+///
+/// @detail The results of the outputs live until the end of the program, which is indicated by the size of the
+///         program. An instruction that is never read is its own last use.
+///
+/// @param hasRegister For each instruction, whether its result is kept in a register. An instruction without one is
+///                    treated as a view of its operands, so its uses extend the lifetimes of its operands. When empty,
+///                    every instruction has a register.
+auto
+computeLastUses(const Program& program, const std::vector<bool>& hasRegister = {}) -> std::vector<std::uint32_t>;
+
+/// @brief Assigns reusable register slots to the results of a program, with a linear scan over the instructions.
+///
+/// @detail A register is taken when an instruction produces its result and released after the last instruction that
+///         reads it, so an instruction never writes to the register of one of its operands. Released registers are
+///         kept in one free list per register class and size. Since a register is only ever reused for a result of
+///         the same class and size, each slot that starts a register always has the same class and size.
+class RegisterAllocator final
+{
+public:
+  explicit RegisterAllocator(const Program& program);
+
+  /// @brief Sets the register class of each instruction's result, or @ref RegisterAllocation::noRegister to leave it
+  ///        without a register. By default, every instruction has a register of the same class.
+  void setRegisterClasses(std::vector<std::uint32_t> classes) { m_classes = std::move(classes); }
+
+  auto allocate() const -> RegisterAllocation;
+
+private:
+  const Program& m_program;
+
+  std::vector<std::uint32_t> m_classes;
+};
@@ -0,0 +1,44 @@
+#include "textpatch.h"
+
+#include <QString>
+#include <QTextCursor>
+#include <QTextEdit>
+
+#include <algorithm>
+
+void
+patchPlainText(QTextEdit& edit, const QString& previousText, const QString& text)
+{
+  if (previousText.isEmpty() || text.isEmpty()) {
+    edit.setPlainText(text);
+    return;
+  }
+
+  const auto maxCommonSize = std::min(previousText.size(), text.size());
+
+  decltype(previousText.size()) prefixSize = 0;
+
+  while ((prefixSize < maxCommonSize) && (previousText[prefixSize] == text[prefixSize]))
+    prefixSize++;
+
+  if ((prefixSize == previousText.size()) && (prefixSize == text.size()))
+    return;
+
+  /* The common end must not overlap the common start, in either text. */
+
+  decltype(previousText.size()) suffixSize = 0;
+
+  while (((prefixSize + suffixSize) < maxCommonSize) &&
+         (previousText[previousText.size() - 1 - suffixSize] == text[text.size() - 1 - suffixSize]))
+    suffixSize++;
+
+  /* A position in the document counts each character of the plain text once, including line breaks. */
+
+  QTextCursor cursor(edit.document());
+
+  cursor.beginEditBlock();
+  cursor.setPosition(static_cast<int>(prefixSize));
+  cursor.setPosition(static_cast<int>(previousText.size() - suffixSize), QTextCursor::KeepAnchor);
+  cursor.insertText(text.mid(prefixSize, text.size() - prefixSize - suffixSize));
+  cursor.endEditBlock();
+}
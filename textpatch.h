@@ -0,0 +1,15 @@
+#pragma once
+
+class QString;
+class QTextEdit;
+
+/// @brief Changes the text of an editor by replacing only the part that differs from its previous text.
+///
+/// @detail Replacing the whole text of an editor lays out and highlights all of it again and loses the scroll
+///         position, which gets slow for the listings of large models. Most edits of a model only change part of a
+///         listing, so the common start and end are left in place.
+///
+/// @param previousText The text that the editor currently holds, which is compared against instead of reading it back
+///                     from the editor.
+void
+patchPlainText(QTextEdit& edit, const QString& previousText, const QString& text);
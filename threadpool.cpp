@@ -0,0 +1,167 @@
+#include "threadpool.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace {
+
+/// @brief The pool that the current thread works for, if any.
+thread_local const ThreadPool* t_pool = nullptr;
+
+/// @brief The index of the current thread among the workers of @ref t_pool.
+thread_local std::size_t t_workerIndex = 0;
+
+} // namespace
+
+ThreadPool::ThreadPool(std::size_t threadCount)
+{
+  if (threadCount == 0)
+    threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+  m_workers.reserve(threadCount);
+
+  for (std::size_t i = 0; i < threadCount; i++)
+    m_workers.emplace_back(new Worker());
+
+  /* The workers are only started once all of the queues exist, since any of them may be stolen from. */
+
+  for (std::size_t i = 0; i < threadCount; i++)
+    m_workers[i]->thread = std::thread([this, i]() { run(i); });
+}
+
+ThreadPool::~ThreadPool()
+{
+  wait();
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stopping = true;
+  }
+
+  m_taskAvailable.notify_all();
+
+  for (auto& worker : m_workers)
+    worker->thread.join();
+}
+
+void
+ThreadPool::submit(Task task)
+{
+  const std::size_t workerIndex = (t_pool == this) ? t_workerIndex : (m_nextWorker++ % m_workers.size());
+
+  m_pendingCount++;
+
+  {
+    Worker& worker = *m_workers[workerIndex];
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    worker.tasks.emplace_back(std::move(task));
+  }
+
+  /* A worker counts itself as sleeping before it checks for tasks, and this checks for sleepers after counting the
+   * task, so at least one of the two sees the other. Taking the mutex makes sure that a sleeper which didn't see the
+   * task is already waiting when it is notified. */
+
+  m_queuedCount++;
+
+  if (m_sleepingCount.load() > 0) {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+    }
+    m_taskAvailable.notify_one();
+  }
+}
+
+void
+ThreadPool::wait()
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+
+  m_idle.wait(lock, [this]() { return m_pendingCount.load() == 0; });
+}
+
+void
+ThreadPool::run(std::size_t workerIndex)
+{
+  t_pool = this;
+  t_workerIndex = workerIndex;
+
+  for (;;) {
+
+    /* Claim one of the queued tasks first, then go and find it. Tasks are queued before they are counted, so a claimed
+     * task is always in one of the queues, but another worker may take it first and leave this one to find another. */
+
+    if (!claim()) {
+
+      std::unique_lock<std::mutex> lock(m_mutex);
+
+      m_sleepingCount++;
+
+      m_taskAvailable.wait(lock, [this]() { return m_stopping || (m_queuedCount.load() > 0); });
+
+      m_sleepingCount--;
+
+      if (m_stopping && (m_queuedCount.load() == 0))
+        return;
+
+      continue;
+    }
+
+    Task task;
+
+    while (!take(workerIndex, task))
+      std::this_thread::yield();
+
+    task();
+
+    if (--m_pendingCount == 0) {
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+      }
+      m_idle.notify_all();
+    }
+  }
+}
+
+auto
+ThreadPool::claim() -> bool
+{
+  auto count = m_queuedCount.load();
+
+  while (count > 0) {
+    if (m_queuedCount.compare_exchange_weak(count, count - 1))
+      return true;
+  }
+
+  return false;
+}
+
+auto
+ThreadPool::take(std::size_t workerIndex, Task& task) -> bool
+{
+  {
+    Worker& own = *m_workers[workerIndex];
+
+    std::lock_guard<std::mutex> lock(own.mutex);
+
+    if (!own.tasks.empty()) {
+      task = std::move(own.tasks.back());
+      own.tasks.pop_back();
+      return true;
+    }
+  }
+
+  for (std::size_t i = 1; i < m_workers.size(); i++) {
+
+    Worker& victim = *m_workers[(workerIndex + i) % m_workers.size()];
+
+    std::lock_guard<std::mutex> lock(victim.mutex);
+
+    if (!victim.tasks.empty()) {
+      task = std::move(victim.tasks.front());
+      victim.tasks.pop_front();
+      return true;
+    }
+  }
+
+  return false;
+}
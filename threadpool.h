@@ -0,0 +1,87 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <cstddef>
+
+/// @brief Runs tasks on a fixed set of worker threads, balancing them by work stealing.
+///
+/// @detail Each worker has its own queue. Tasks submitted from outside the pool are dealt out to the queues in turn,
+///         and tasks submitted from a worker go to the back of its own queue. A worker takes tasks from the back of its
+///         own queue, which keeps related work on one thread, and when that runs dry it steals from the front of the
+///         other queues. The queues are locked individually and the counters of the pool are atomic, so workers only
+///         contend when one of them steals. The mutex of the pool is only taken to go to sleep and to wake sleepers.
+class ThreadPool final
+{
+public:
+  using Task = std::function<void()>;
+
+  /// @brief Starts the workers.
+  ///
+  /// @param threadCount The number of workers. When zero, one per hardware thread is started.
+  explicit ThreadPool(std::size_t threadCount = 0);
+
+  ThreadPool(const ThreadPool&) = delete;
+
+  auto operator=(const ThreadPool&) -> ThreadPool& = delete;
+
+  /// @brief Waits for the queued tasks to finish and stops the workers.
+  ~ThreadPool();
+
+  auto getThreadCount() const noexcept -> std::size_t { return m_workers.size(); }
+
+  void submit(Task task);
+
+  /// @brief Blocks until every task submitted so far, and every task those submit, has finished.
+  ///
+  /// @note This must not be called from a task, since the task would wait for itself.
+  void wait();
+
+private:
+  struct Worker final
+  {
+    std::mutex mutex;
+
+    std::deque<Task> tasks;
+
+    std::thread thread;
+  };
+
+  void run(std::size_t workerIndex);
+
+  /// @brief Takes a task from a worker's own queue or, failing that, from another worker's queue.
+  auto take(std::size_t workerIndex, Task& task) -> bool;
+
+  /// @brief Claims one of the queued tasks, if there are any, without waiting.
+  auto claim() -> bool;
+
+private:
+  std::vector<std::unique_ptr<Worker>> m_workers;
+
+  /// @brief Used to sleep on when there is nothing to do. It guards @ref m_stopping.
+  std::mutex m_mutex;
+
+  std::condition_variable m_taskAvailable;
+
+  std::condition_variable m_idle;
+
+  /// @brief The number of tasks queued that have not yet been claimed by a worker.
+  std::atomic<std::size_t> m_queuedCount{ 0 };
+
+  /// @brief The number of tasks submitted that have not yet finished.
+  std::atomic<std::size_t> m_pendingCount{ 0 };
+
+  /// @brief The number of workers that are waiting for a task, so that submitting only wakes them when needed.
+  std::atomic<std::size_t> m_sleepingCount{ 0 };
+
+  std::atomic<std::size_t> m_nextWorker{ 0 };
+
+  bool m_stopping = false;
+};